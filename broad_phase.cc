@@ -0,0 +1,57 @@
+#include "broad_phase.h"
+#include <algorithm>
+
+namespace {
+    struct SweepEntry {
+        Vector::coordinate_t x1, x2, y1, y2;
+        Rectangles::size_t index;
+    };
+
+    std::vector<SweepEntry> sorted_entries(const Rectangles &rects) {
+        std::vector<SweepEntry> entries;
+        entries.reserve(rects.size());
+        for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+            const Rectangle &rect = rects.unchecked(i);
+            entries.push_back({rect.pos().x(), rect.pos().x() + rect.width(),
+                               rect.pos().y(), rect.pos().y() + rect.height(), i});
+        }
+        std::sort(entries.begin(), entries.end(), [](const SweepEntry &a, const SweepEntry &b) {
+            return a.x1 < b.x1;
+        });
+        return entries;
+    }
+
+    void sweep(const std::vector<SweepEntry> &entries, std::size_t first, std::size_t last,
+               std::vector<OverlapPair> &out) {
+        for (std::size_t i = first; i < last; ++i) {
+            const SweepEntry &a = entries[i];
+            for (std::size_t j = i + 1; j < entries.size() && entries[j].x1 < a.x2; ++j) {
+                const SweepEntry &b = entries[j];
+                if (a.y1 < b.y2 && b.y1 < a.y2)
+                    out.emplace_back(std::min(a.index, b.index), std::max(a.index, b.index));
+            }
+        }
+    }
+}
+
+void find_overlaps(const Rectangles &rects, std::vector<OverlapPair> &out) {
+    out.clear();
+    const std::vector<SweepEntry> entries = sorted_entries(rects);
+    sweep(entries, 0, entries.size(), out);
+}
+
+void find_overlaps(ParallelExecutor &executor, const Rectangles &rects, std::vector<OverlapPair> &out,
+                   std::size_t grain) {
+    out.clear();
+    const std::vector<SweepEntry> entries = sorted_entries(rects);
+
+    // Every chunk of left endpoints is swept into its own buffer.
+    grain = std::max<std::size_t>(grain, 1);
+    std::vector<std::vector<OverlapPair>> partial((entries.size() + grain - 1) / grain);
+    executor.for_chunks(entries.size(), grain, [&](std::size_t first, std::size_t last) {
+        sweep(entries, first, last, partial[first / grain]);
+    });
+    for (const std::vector<OverlapPair> &pairs:partial) {
+        out.insert(out.end(), pairs.begin(), pairs.end());
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef JNP1_3_BROAD_PHASE_H
+#define JNP1_3_BROAD_PHASE_H
+
+#include "geometry.h"
+#include "parallel.h"
+#include <utility>
+#include <vector>
+
+using OverlapPair = std::pair<Rectangles::size_t, Rectangles::size_t>;
+
+// Replaces the contents of out with every pair (i, j), i < j, of
+// intersecting rectangles, in unspecified order. Sorts the rectangles
+// along x and sweeps, testing y only for pairs whose x ranges overlap.
+void find_overlaps(const Rectangles &rects, std::vector<OverlapPair> &out);
+
+// Same as find_overlaps(rects, out), with the sweep split into chunks of
+// grain left endpoints.
+void find_overlaps(ParallelExecutor &executor, const Rectangles &rects, std::vector<OverlapPair> &out,
+                   std::size_t grain = 1 << 12);
+
+#endif //JNP1_3_BROAD_PHASE_H
@@ -0,0 +1,91 @@
+#include "coverage.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    struct Event {
+        Vector::coordinate_t x;
+        Vector::coordinate_t y1;
+        Vector::coordinate_t y2;
+        int delta;
+    };
+
+    // Segment tree over the elementary intervals [ys[i], ys[i + 1]). A node
+    // is fully covered while its count is positive; otherwise its length is
+    // the sum of its children.
+    class CoverTree {
+    public:
+        explicit CoverTree(const std::vector<Vector::coordinate_t> &ys)
+                : _ys(ys), _count(4 * ys.size(), 0), _length(4 * ys.size(), 0) {}
+
+        void update(Vector::coordinate_t y1, Vector::coordinate_t y2, int delta) {
+            const std::size_t first = std::lower_bound(this->_ys.begin(), this->_ys.end(), y1) - this->_ys.begin();
+            const std::size_t last = std::lower_bound(this->_ys.begin(), this->_ys.end(), y2) - this->_ys.begin();
+            this->update(1, 0, this->_ys.size() - 1, first, last, delta);
+        }
+
+        [[nodiscard]] std::uint64_t covered() const {
+            return this->_length[1];
+        }
+
+    private:
+        void update(std::size_t node, std::size_t lo, std::size_t hi, std::size_t first, std::size_t last, int delta) {
+            if (last <= lo || hi <= first)
+                return;
+            if (first <= lo && hi <= last) {
+                this->_count[node] += delta;
+            } else {
+                const std::size_t mid = lo + (hi - lo) / 2;
+                this->update(2 * node, lo, mid, first, last, delta);
+                this->update(2 * node + 1, mid, hi, first, last, delta);
+            }
+
+            if (this->_count[node] > 0) {
+                // Unsigned difference, exact even when it exceeds the signed range.
+                this->_length[node] = static_cast<std::uint64_t>(this->_ys[hi]) - static_cast<std::uint64_t>(this->_ys[lo]);
+            } else if (hi - lo == 1) {
+                this->_length[node] = 0;
+            } else {
+                this->_length[node] = this->_length[2 * node] + this->_length[2 * node + 1];
+            }
+        }
+
+        const std::vector<Vector::coordinate_t> &_ys;
+        std::vector<int> _count;
+        std::vector<std::uint64_t> _length;
+    };
+}
+
+wide_area_t covered_area(const Rectangles &rects) {
+    if (rects.size() == 0)
+        return 0;
+
+    std::vector<Event> events;
+    std::vector<Vector::coordinate_t> ys;
+    events.reserve(2 * rects.size());
+    ys.reserve(2 * rects.size());
+    for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+        const Rectangle &rect = rects.unchecked(i);
+        const Vector::coordinate_t y2 = rect.pos().y() + rect.height();
+        events.push_back({rect.pos().x(), rect.pos().y(), y2, 1});
+        events.push_back({rect.pos().x() + rect.width(), rect.pos().y(), y2, -1});
+        ys.push_back(rect.pos().y());
+        ys.push_back(y2);
+    }
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+        return a.x < b.x;
+    });
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    CoverTree tree(ys);
+    wide_area_t area = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        if (i > 0) {
+            const std::uint64_t dx = static_cast<std::uint64_t>(events[i].x) - static_cast<std::uint64_t>(events[i - 1].x);
+            area += static_cast<wide_area_t>(tree.covered()) * dx;
+        }
+        tree.update(events[i].y1, events[i].y2, events[i].delta);
+    }
+    return area;
+}
@@ -0,0 +1,10 @@
+#ifndef JNP1_3_COVERAGE_H
+#define JNP1_3_COVERAGE_H
+
+#include "geometry.h"
+
+// Area of the union of the rectangles, counting overlaps once. Sweeps along
+// x with a segment tree over the distinct y coordinates, O(n log n).
+wide_area_t covered_area(const Rectangles &rects);
+
+#endif //JNP1_3_COVERAGE_H
@@ -0,0 +1,118 @@
+#include "dirty_region.h"
+#include <cassert>
+#include <utility>
+
+void DirtyRegion::subtract(const Rectangle &piece, const Rectangle &cut, std::vector<Rectangle> &out) {
+    const std::optional<Rectangle> common = intersection(piece, cut);
+    if (!common) {
+        out.push_back(piece);
+        return;
+    }
+    // Full-width strips below and above the common part, then the parts
+    // left and right of it.
+    const Vector::coordinate_t px1 = piece.pos().x(), py1 = piece.pos().y();
+    const Vector::coordinate_t px2 = px1 + piece.width(), py2 = py1 + piece.height();
+    const Vector::coordinate_t cx1 = common->pos().x(), cy1 = common->pos().y();
+    const Vector::coordinate_t cx2 = cx1 + common->width(), cy2 = cy1 + common->height();
+    if (py1 < cy1)
+        out.emplace_back(piece.width(), cy1 - py1, Position(px1, py1));
+    if (cy2 < py2)
+        out.emplace_back(piece.width(), py2 - cy2, Position(px1, cy2));
+    if (px1 < cx1)
+        out.emplace_back(cx1 - px1, common->height(), Position(px1, cy1));
+    if (cx2 < px2)
+        out.emplace_back(px2 - cx2, common->height(), Position(cx2, cy1));
+}
+
+void DirtyRegion::insert(const Rectangle &rect) {
+    this->_bounds = this->_bounds ? bounding_union(*this->_bounds, rect) : rect;
+
+    std::vector<Rectangle> pieces{rect};
+    std::vector<Rectangle> rest;
+    for (id_t id:this->_index.overlapping(rect)) {
+        rest.clear();
+        for (const Rectangle &piece:pieces) {
+            subtract(piece, this->_by_id[id], rest);
+        }
+        pieces.swap(rest);
+    }
+    for (const Rectangle &piece:pieces) {
+        this->_area += wide_area(piece);
+        this->add(piece);
+    }
+}
+
+void DirtyRegion::add(Rectangle rect) {
+    for (;;) {
+        if (auto it = this->_top.find(detail::bottom_edge(rect)); it != this->_top.end()) {
+            rect = merge_horizontally(this->take(it->second), rect);
+        } else if (auto it = this->_bottom.find(detail::top_edge(rect)); it != this->_bottom.end()) {
+            rect = merge_horizontally(rect, this->take(it->second));
+        } else if (auto it = this->_right.find(detail::left_edge(rect)); it != this->_right.end()) {
+            rect = merge_vertically(this->take(it->second), rect);
+        } else if (auto it = this->_left.find(detail::right_edge(rect)); it != this->_left.end()) {
+            rect = merge_vertically(rect, this->take(it->second));
+        } else {
+            break;
+        }
+    }
+
+    const id_t id = this->_index.insert(rect);
+    assert(id <= this->_by_id.size());
+    if (id == this->_by_id.size()) {
+        this->_by_id.push_back(rect);
+        this->_slot.push_back(this->_live.size());
+    } else {
+        this->_by_id[id] = rect;
+        this->_slot[id] = this->_live.size();
+    }
+    this->_live.push_back(id);
+    this->_bottom.emplace(detail::bottom_edge(rect), id);
+    this->_top.emplace(detail::top_edge(rect), id);
+    this->_left.emplace(detail::left_edge(rect), id);
+    this->_right.emplace(detail::right_edge(rect), id);
+}
+
+Rectangle DirtyRegion::take(DirtyRegion::id_t id) {
+    const Rectangle rect = this->_by_id[id];
+    this->_index.erase(id);
+    this->_bottom.erase(detail::bottom_edge(rect));
+    this->_top.erase(detail::top_edge(rect));
+    this->_left.erase(detail::left_edge(rect));
+    this->_right.erase(detail::right_edge(rect));
+
+    const std::size_t slot = this->_slot[id];
+    this->_live[slot] = this->_live.back();
+    this->_slot[this->_live[slot]] = slot;
+    this->_live.pop_back();
+    return rect;
+}
+
+void DirtyRegion::clear() {
+    *this = DirtyRegion();
+}
+
+std::size_t DirtyRegion::size() const {
+    return this->_live.size();
+}
+
+bool DirtyRegion::empty() const {
+    return this->_live.empty();
+}
+
+Rectangles DirtyRegion::rectangles() const {
+    Rectangles res;
+    res.reserve(this->_live.size());
+    for (id_t id:this->_live) {
+        res.push_back(this->_by_id[id]);
+    }
+    return res;
+}
+
+const std::optional<Rectangle> &DirtyRegion::bounds() const {
+    return this->_bounds;
+}
+
+wide_area_t DirtyRegion::area() const {
+    return this->_area;
+}
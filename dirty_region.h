@@ -0,0 +1,75 @@
+#ifndef JNP1_3_DIRTY_REGION_H
+#define JNP1_3_DIRTY_REGION_H
+
+#include "edge_key.h"
+#include "geometry.h"
+#include "spatial_index.h"
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Union of the rectangles inserted so far, kept as a set of disjoint
+// rectangles. An insert keeps only the part not covered yet and merges it
+// with every neighbour sharing a whole edge, by the same rules as merge_all,
+// so tiles marked in row order collapse into few rectangles. Every merge
+// removes a rectangle, which makes inserts amortized O(log n) plus the
+// number of rectangles they overlap.
+class DirtyRegion {
+public:
+    DirtyRegion() = default;
+
+    DirtyRegion(const DirtyRegion &other) = default;
+
+    DirtyRegion &operator=(const DirtyRegion &other) = default;
+
+    DirtyRegion(DirtyRegion &&other) = default;
+
+    DirtyRegion &operator=(DirtyRegion &&other) = default;
+
+    void insert(const Rectangle &rect);
+
+    void clear();
+
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] bool empty() const;
+
+    // The disjoint rectangles covering the region, in unspecified order.
+    [[nodiscard]] Rectangles rectangles() const;
+
+    // std::nullopt while the region is empty.
+    [[nodiscard]] const std::optional<Rectangle> &bounds() const;
+
+    [[nodiscard]] wide_area_t area() const;
+
+private:
+    using id_t = SpatialIndex::id_t;
+
+    using EdgeMap = std::unordered_map<detail::EdgeKey, id_t, detail::EdgeKeyHash>;
+
+    // Appends to out the parts of piece outside cut.
+    static void subtract(const Rectangle &piece, const Rectangle &cut, std::vector<Rectangle> &out);
+
+    // Stores rect, disjoint from the region, after merging in its neighbours.
+    void add(Rectangle rect);
+
+    // Removes the stored rectangle with the given id and returns it.
+    Rectangle take(id_t id);
+
+    // Indexed by the ids of the spatial index, which reuses the ids of
+    // erased rectangles, so they only grow with the most rectangles the
+    // region has held at once.
+    SpatialIndex _index;
+    std::vector<Rectangle> _by_id;
+    std::vector<std::size_t> _slot;
+    std::vector<id_t> _live;
+    EdgeMap _bottom;
+    EdgeMap _top;
+    EdgeMap _left;
+    EdgeMap _right;
+    std::optional<Rectangle> _bounds;
+    wide_area_t _area = 0;
+};
+
+#endif //JNP1_3_DIRTY_REGION_H
@@ -0,0 +1,49 @@
+#ifndef JNP1_3_EDGE_KEY_H
+#define JNP1_3_EDGE_KEY_H
+
+#include "geometry.h"
+#include <cstddef>
+#include <functional>
+
+namespace detail {
+    // A whole edge of a rectangle: where it starts along its axis, how long
+    // it is, and the line across the axis it lies on. Two rectangles can be
+    // merged exactly when the far edge of one is the near edge of the other.
+    struct EdgeKey {
+        Vector::coordinate_t offset;
+        Vector::coordinate_t length;
+        Vector::coordinate_t line;
+
+        bool operator==(const EdgeKey &other) const {
+            return this->offset == other.offset && this->length == other.length && this->line == other.line;
+        }
+    };
+
+    struct EdgeKeyHash {
+        std::size_t operator()(const EdgeKey &key) const {
+            std::hash<Vector::coordinate_t> h;
+            std::size_t seed = h(key.offset);
+            seed ^= h(key.length) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+            seed ^= h(key.line) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    inline EdgeKey bottom_edge(const Rectangle &rect) {
+        return EdgeKey{rect.pos().x(), rect.width(), rect.pos().y()};
+    }
+
+    inline EdgeKey top_edge(const Rectangle &rect) {
+        return EdgeKey{rect.pos().x(), rect.width(), rect.pos().y() + rect.height()};
+    }
+
+    inline EdgeKey left_edge(const Rectangle &rect) {
+        return EdgeKey{rect.pos().y(), rect.height(), rect.pos().x()};
+    }
+
+    inline EdgeKey right_edge(const Rectangle &rect) {
+        return EdgeKey{rect.pos().y(), rect.height(), rect.pos().x() + rect.width()};
+    }
+}
+
+#endif //JNP1_3_EDGE_KEY_H
@@ -1,224 +1,463 @@
 #include "geometry.h"
+#include "edge_key.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JNP1_3_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 namespace {
-    bool can_be_merged_horizontally(const Rectangle &rect1, const Rectangle &rect2) {
-        return rect1.width() == rect2.width()
-               && rect1.pos().x() == rect2.pos().x()
-               && rect1.pos().y() + rect1.height() == rect2.pos().y();
+    // Bulk translation works on the raw storage of Rectangles: every Rectangle
+    // is four coordinates wide and the corner occupies two consecutive ones
+    // at index pos_index. delta holds the vector laid out the same way
+    // (zeros everywhere except the corner), so whole rectangles can be added.
+    using translate_kernel_t = void (*)(Vector::coordinate_t *data, std::size_t count,
+                                        const Vector::coordinate_t *delta);
+
+    constexpr std::size_t coordinates_per_rectangle = 4;
+
+    void translate_scalar(Vector::coordinate_t *data, std::size_t count, const Vector::coordinate_t *delta) {
+        for (std::size_t i = 0; i < count * coordinates_per_rectangle; ++i) {
+            data[i] += delta[i % coordinates_per_rectangle];
+        }
     }
 
-    bool can_be_merged_vertically(const Rectangle &rect1, const Rectangle &rect2) {
-        return rect1.height() == rect2.height()
-               && rect1.pos().y() == rect2.pos().y()
-               && rect1.pos().x() + rect1.width() == rect2.pos().x();
+#ifdef JNP1_3_X86_SIMD
+    __attribute__((target("sse2")))
+    void translate_sse2(Vector::coordinate_t *data, std::size_t count, const Vector::coordinate_t *delta) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(delta));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(delta + 2));
+        for (std::size_t i = 0; i < count; ++i, data += coordinates_per_rectangle) {
+            auto *p = reinterpret_cast<__m128i *>(data);
+            _mm_storeu_si128(p, _mm_add_epi64(_mm_loadu_si128(p), lo));
+            _mm_storeu_si128(p + 1, _mm_add_epi64(_mm_loadu_si128(p + 1), hi));
+        }
     }
 
-    Rectangle merge_vertically_helper(const Rectangle &rect1, const Rectangle &rect2) {
-        Vector::coordinate_t new_width = rect1.width() + rect2.width();
-        Vector::coordinate_t new_height = rect1.height();
-        return Rectangle(new_width, new_height, rect1.pos());
+    __attribute__((target("avx2")))
+    void translate_avx2(Vector::coordinate_t *data, std::size_t count, const Vector::coordinate_t *delta) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(delta));
+        std::size_t i = 0;
+        for (; i + 2 <= count; i += 2, data += 2 * coordinates_per_rectangle) {
+            auto *p = reinterpret_cast<__m256i *>(data);
+            _mm256_storeu_si256(p, _mm256_add_epi64(_mm256_loadu_si256(p), d));
+            _mm256_storeu_si256(p + 1, _mm256_add_epi64(_mm256_loadu_si256(p + 1), d));
+        }
+        if (i < count) {
+            auto *p = reinterpret_cast<__m256i *>(data);
+            _mm256_storeu_si256(p, _mm256_add_epi64(_mm256_loadu_si256(p), d));
+        }
     }
-
-    Rectangle merge_horizontally_helper(const Rectangle &rect1, const Rectangle &rect2) {
-        Vector::coordinate_t new_width = rect1.width();
-        Vector::coordinate_t new_height = rect1.height() + rect2.height();
-        return Rectangle(new_width, new_height, rect1.pos());
+#endif
+
+    translate_kernel_t select_translate_kernel() {
+#ifdef JNP1_3_X86_SIMD
+        if constexpr (sizeof(Vector::coordinate_t) == sizeof(int64_t)) {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return translate_avx2;
+            if (__builtin_cpu_supports("sse2"))
+                return translate_sse2;
+        }
+#endif
+        return translate_scalar;
     }
-}
-
-Vector::Vector(Vector::coordinate_t x, Vector::coordinate_t y) : _x(x), _y(y) {}
-
-Vector::Vector(const Position &point) : _x(point.x()), _y(point.y()) {}
 
-Vector::coordinate_t Vector::x() const {
-    return this->_x;
-}
-
-Vector::coordinate_t Vector::y() const {
-    return this->_y;
-}
+    // Reflection swaps the coordinates within each of the two pairs of
+    // a Rectangle: the corner and the dimensions.
+    using reflect_kernel_t = void (*)(Vector::coordinate_t *data, std::size_t count);
 
-Vector Vector::reflection() const {
-    return Vector(this->_y, this->_x);
-}
-
-bool Vector::operator==(const Vector &other) const {
-    return this->_x == other._x && this->_y == other._y;
-}
-
-Vector &Vector::operator+=(const Vector &other) {
-    this->_x += other._x;
-    this->_y += other._y;
-    return *this;
-}
-
-
-Position::Position(Vector::coordinate_t x, Vector::coordinate_t y) : _vec(x, y) {}
-
-Position::Position(const Vector &vec) : _vec(vec) {}
-
-const Position &Position::origin() {
-    static Position morigin = Position(0, 0);
-    return morigin;
-}
-
-Vector::coordinate_t Position::x() const {
-    return this->_vec.x();
-}
-
-Vector::coordinate_t Position::y() const {
-    return this->_vec.y();
-}
-
-Position Position::reflection() const {
-    return Position(this->_vec.reflection());
-}
-
-bool Position::operator==(const Position &other) const {
-    return this->_vec == other._vec;
-}
-
-Position &Position::operator+=(const Vector &vector) {
-    this->_vec += vector;
-    return *this;
-}
-
-Rectangle::Rectangle(Vector::coordinate_t width, Vector::coordinate_t height, const Position &pos) : _width(width),
-                                                                                                     _height(height),
-                                                                                                     _left_bottom_corner(
-                                                                                                             pos) {
-    assert(width > 0 && height > 0);
-}
-
-bool Rectangle::operator==(const Rectangle &rect) const {
-    return this->_left_bottom_corner == rect._left_bottom_corner
-           && this->width() == rect.width()
-           && this->height() == rect.height();
-}
-
-const Position &Rectangle::pos() const {
-    return this->_left_bottom_corner;
-}
-
-Vector::coordinate_t Rectangle::width() const {
-    return this->_width;
-}
+    void reflect_scalar(Vector::coordinate_t *data, std::size_t count) {
+        for (std::size_t i = 0; i < count * coordinates_per_rectangle; i += 2) {
+            std::swap(data[i], data[i + 1]);
+        }
+    }
 
-Vector::coordinate_t Rectangle::height() const {
-    return this->_height;
-}
+#ifdef JNP1_3_X86_SIMD
+    __attribute__((target("sse2")))
+    void reflect_sse2(Vector::coordinate_t *data, std::size_t count) {
+        auto *p = reinterpret_cast<__m128i *>(data);
+        for (std::size_t i = 0; i < 2 * count; ++i) {
+            _mm_storeu_si128(p + i, _mm_shuffle_epi32(_mm_loadu_si128(p + i), _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+    }
 
-Rectangle Rectangle::reflection() const {
-    return Rectangle(this->height(), this->width(), this->pos().reflection());
-}
+    __attribute__((target("avx2")))
+    void reflect_avx2(Vector::coordinate_t *data, std::size_t count) {
+        auto *p = reinterpret_cast<__m256i *>(data);
+        std::size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            _mm256_storeu_si256(p + i, _mm256_shuffle_epi32(_mm256_loadu_si256(p + i), _MM_SHUFFLE(1, 0, 3, 2)));
+            _mm256_storeu_si256(p + i + 1,
+                                _mm256_shuffle_epi32(_mm256_loadu_si256(p + i + 1), _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+        if (i < count) {
+            _mm256_storeu_si256(p + i, _mm256_shuffle_epi32(_mm256_loadu_si256(p + i), _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+    }
+#endif
+
+    reflect_kernel_t select_reflect_kernel() {
+#ifdef JNP1_3_X86_SIMD
+        if constexpr (sizeof(Vector::coordinate_t) == sizeof(int64_t)) {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return reflect_avx2;
+            if (__builtin_cpu_supports("sse2"))
+                return reflect_sse2;
+        }
+#endif
+        return reflect_scalar;
+    }
 
-Rectangle &Rectangle::operator+=(const Vector &vec) {
-    this->_left_bottom_corner += vec;
-    return *this;
-}
+    // Index of the corner within the raw storage of a Rectangle, if the
+    // raw kernels can be used: Rectangle has to be exactly four packed
+    // coordinates. The offset is taken from a live object rather than assumed.
+    std::optional<std::size_t> packed_corner_index(const Rectangle &rect) {
+        constexpr bool packed = sizeof(Rectangle) == coordinates_per_rectangle * sizeof(Vector::coordinate_t)
+                                && sizeof(Position) == 2 * sizeof(Vector::coordinate_t);
+        const auto pos_offset = reinterpret_cast<const char *>(&rect.pos()) - reinterpret_cast<const char *>(&rect);
+        const auto pos_index = static_cast<std::size_t>(pos_offset) / sizeof(Vector::coordinate_t);
+        if (!packed || pos_index + 2 > coordinates_per_rectangle)
+            return std::nullopt;
+        return pos_index;
+    }
 
-Rectangle::area_t Rectangle::area() const {
-    return this->width() * this->height();
-}
+    // Part of merge_unordered: decides whether rectangles form a guillotine
+    // tiling of bounds. Every region of the guillotine tree keeps its
+    // rectangles on four doubly linked lists, sorted once by the left, right,
+    // bottom and top edge. The four lists are scanned inward in lockstep
+    // until one of them reaches a line no rectangle crosses; the scanned
+    // part is split off, so a split costs the size of the part it cuts off,
+    // up to sorting it.
+    class GuillotineTiling {
+    public:
+        explicit GuillotineTiling(const Rectangles &rects);
+
+        bool tiles(const Rectangle &bounds);
+
+    private:
+        static constexpr std::size_t orders = 4;
+
+        static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+        struct Region {
+            std::array<std::size_t, orders> head;
+            std::size_t count;
+            Rectangle area;
+        };
+
+        // The scan of one list: the next rectangle, and how far the ones
+        // before it reach into the region.
+        struct Scan {
+            std::size_t node;
+            Vector::coordinate_t reach;
+        };
+
+        // Order o lists the rectangles by their low edge along axis o / 2
+        // ascending when o is even, and by their high edge descending when
+        // it is odd.
+        static Vector::coordinate_t low(const Rectangle &rect, std::size_t o);
+
+        static Vector::coordinate_t high(const Rectangle &rect, std::size_t o);
+
+        // Moves scan past its next rectangle, or sets cut and leaves it there
+        // if that rectangle starts a new part. Returns false on a gap or
+        // a rectangle leaving region.
+        bool step(const Region &region, std::size_t o, Scan &scan, bool &cut) const;
+
+        // Moves the rectangles before scan.node on list o from region to a new
+        // region covering the part of region.area they reach.
+        Region split(Region &region, std::size_t o, const Scan &scan);
+
+        void unlink(Region &region, std::size_t o, std::size_t i);
+
+        const Rectangles &_rects;
+        std::array<std::vector<std::size_t>, orders> _rank;
+        std::array<std::vector<std::size_t>, orders> _next;
+        std::array<std::vector<std::size_t>, orders> _prev;
+    };
+
+    GuillotineTiling::GuillotineTiling(const Rectangles &rects) : _rects(rects) {
+        for (std::size_t o = 0; o < orders; ++o) {
+            this->_rank[o].resize(rects.size());
+            this->_next[o].resize(rects.size());
+            this->_prev[o].resize(rects.size());
+        }
+    }
 
+    Vector::coordinate_t GuillotineTiling::low(const Rectangle &rect, std::size_t o) {
+        return o < 2 ? rect.pos().x() : rect.pos().y();
+    }
 
-Rectangles::Rectangles(std::initializer_list<Rectangle> rects) : _rects(rects) {}
+    Vector::coordinate_t GuillotineTiling::high(const Rectangle &rect, std::size_t o) {
+        return o < 2 ? rect.pos().x() + rect.width() : rect.pos().y() + rect.height();
+    }
 
+    bool GuillotineTiling::tiles(const Rectangle &bounds) {
+        const std::size_t n = this->_rects.size();
+        Region whole{{}, n, bounds};
+        std::vector<std::size_t> sorted(n);
+        for (std::size_t o = 0; o < orders; ++o) {
+            for (std::size_t i = 0; i < n; ++i)
+                sorted[i] = i;
+            std::sort(sorted.begin(), sorted.end(), [&](std::size_t a, std::size_t b) {
+                return o % 2 == 0 ? low(this->_rects.unchecked(a), o) < low(this->_rects.unchecked(b), o)
+                                  : high(this->_rects.unchecked(a), o) > high(this->_rects.unchecked(b), o);
+            });
+            whole.head[o] = sorted[0];
+            for (std::size_t r = 0; r < n; ++r) {
+                this->_rank[o][sorted[r]] = r;
+                this->_prev[o][sorted[r]] = r == 0 ? none : sorted[r - 1];
+                this->_next[o][sorted[r]] = r + 1 == n ? none : sorted[r + 1];
+            }
+        }
 
-bool Rectangles::operator==(const Rectangles &rectangles) {
-    if (this->size() != rectangles.size())
-        return false;
-    for (Rectangles::size_t i = 0; i > this->size(); ++i) {
-        if (!(this->_rects[i] == rectangles._rects[i]))
-            return false;
+        std::vector<Region> regions{whole};
+        while (!regions.empty()) {
+            Region region = regions.back();
+            regions.pop_back();
+            if (region.count == 1) {
+                if (!(this->_rects.unchecked(region.head[0]) == region.area))
+                    return false;
+                continue;
+            }
+
+            std::array<Scan, orders> scans;
+            for (std::size_t o = 0; o < orders; ++o)
+                scans[o] = {region.head[o], o % 2 == 0 ? low(region.area, o) : high(region.area, o)};
+            std::size_t cut_order = none;
+            for (std::size_t steps = 0; cut_order == none; ++steps) {
+                if (steps == region.count)
+                    return false;
+                for (std::size_t o = 0; o < orders && cut_order == none; ++o) {
+                    bool cut = false;
+                    if (!this->step(region, o, scans[o], cut))
+                        return false;
+                    if (cut)
+                        cut_order = o;
+                }
+            }
+            regions.push_back(this->split(region, cut_order, scans[cut_order]));
+            regions.push_back(region);
+        }
+        return true;
     }
-    return true;
-}
 
-Rectangles &Rectangles::operator+=(const Vector &vec) {
-    for (Rectangle &rect:this->_rects) {
-        rect += vec;
+    bool GuillotineTiling::step(const Region &region, std::size_t o, Scan &scan, bool &cut) const {
+        const Rectangle &rect = this->_rects.unchecked(scan.node);
+        const bool first = scan.node == region.head[o];
+        if (o % 2 == 0) {
+            if (low(rect, o) > scan.reach || low(rect, o) < low(region.area, o))
+                return false;
+            cut = !first && low(rect, o) == scan.reach;
+            if (!cut)
+                scan.reach = std::max(scan.reach, high(rect, o));
+        } else {
+            if (high(rect, o) < scan.reach || high(rect, o) > high(region.area, o))
+                return false;
+            cut = !first && high(rect, o) == scan.reach;
+            if (!cut)
+                scan.reach = std::min(scan.reach, low(rect, o));
+        }
+        if (!cut)
+            scan.node = this->_next[o][scan.node];
+        return true;
     }
-    return *this;
-}
 
-Rectangles::size_t Rectangles::size() const {
-    return this->_rects.size();
-}
+    GuillotineTiling::Region GuillotineTiling::split(Region &region, std::size_t o, const Scan &scan) {
+        std::vector<std::size_t> part;
+        for (std::size_t i = region.head[o]; i != scan.node; i = this->_next[o][i])
+            part.push_back(i);
+        for (std::size_t p = 0; p < orders; ++p) {
+            for (std::size_t i:part)
+                this->unlink(region, p, i);
+        }
 
-const Rectangle &Rectangles::operator[](Rectangles::size_t i) const {
-    return this->_rects.at(i);
-}
+        Region res{{}, part.size(), region.area};
+        const Vector::coordinate_t lo = low(region.area, o), hi = high(region.area, o);
+        const Vector::coordinate_t part_lo = o % 2 == 0 ? lo : scan.reach;
+        const Vector::coordinate_t part_hi = o % 2 == 0 ? scan.reach : hi;
+        const Vector::coordinate_t rest_lo = o % 2 == 0 ? scan.reach : lo;
+        const Vector::coordinate_t rest_hi = o % 2 == 0 ? hi : scan.reach;
+        auto span = [&](Vector::coordinate_t from, Vector::coordinate_t to) {
+            const Rectangle &area = region.area;
+            return o < 2 ? Rectangle(to - from, area.height(), Position(from, area.pos().y()))
+                         : Rectangle(area.width(), to - from, Position(area.pos().x(), from));
+        };
+        res.area = span(part_lo, part_hi);
+        region.area = span(rest_lo, rest_hi);
+        region.count -= part.size();
+
+        for (std::size_t p = 0; p < orders; ++p) {
+            std::sort(part.begin(), part.end(), [&](std::size_t a, std::size_t b) {
+                return this->_rank[p][a] < this->_rank[p][b];
+            });
+            res.head[p] = part[0];
+            for (std::size_t r = 0; r < part.size(); ++r) {
+                this->_prev[p][part[r]] = r == 0 ? none : part[r - 1];
+                this->_next[p][part[r]] = r + 1 == part.size() ? none : part[r + 1];
+            }
+        }
+        return res;
+    }
 
-Rectangle &Rectangles::operator[](Rectangles::size_t i) {
-    return this->_rects.at(i);
-}
+    void GuillotineTiling::unlink(Region &region, std::size_t o, std::size_t i) {
+        const std::size_t prev = this->_prev[o][i], next = this->_next[o][i];
+        if (prev == none) {
+            region.head[o] = next;
+        } else {
+            this->_next[o][prev] = next;
+        }
+        if (next != none)
+            this->_prev[o][next] = prev;
+    }
 
+    // Edges of the live rectangles of coalesce. Overlapping input may give
+    // several rectangles the same edge.
+    using EdgeMultimap = std::unordered_multimap<detail::EdgeKey, std::size_t, detail::EdgeKeyHash>;
 
-Rectangle merge_vertically(const Rectangle &rect1, const Rectangle &rect2) {
-    assert(can_be_merged_vertically(rect1, rect2));
-    return merge_vertically_helper(rect1, rect2);
+    void erase_edge(EdgeMultimap &edges, const detail::EdgeKey &key, std::size_t i) {
+        for (auto [it, last] = edges.equal_range(key); it != last; ++it) {
+            if (it->second == i) {
+                edges.erase(it);
+                return;
+            }
+        }
+    }
 }
 
-Rectangle merge_horizontally(const Rectangle &rect1, const Rectangle &rect2) {
-    assert(can_be_merged_horizontally(rect1, rect2));
-    return merge_horizontally_helper(rect1, rect2);
-
-}
+void detail::translate_all(Rectangle *rects, std::size_t count, const Vector &vec) {
+    if (count == 0)
+        return;
 
-Rectangle merge_all(const Rectangles &rectangles) {
-    assert(rectangles.size());
-    Rectangle rect = rectangles[0];
-    for (Rectangles::size_t i = 1; i < rectangles.size(); ++i) {
-        const Rectangle &curr = rectangles[i];
-        if (can_be_merged_horizontally(rect, curr)) {
-            rect = merge_horizontally_helper(rect, curr);
-        } else {
-            rect = merge_vertically(rect, curr);
+    const std::optional<std::size_t> pos_index = packed_corner_index(rects[0]);
+    if (!pos_index) {
+        for (std::size_t i = 0; i < count; ++i) {
+            rects[i] += vec;
         }
+        return;
     }
 
-    return rect;
-}
-
-
-Vector operator+(Vector vec1, const Vector &vec2) {
-    return vec1 += vec2;
-}
+    Vector::coordinate_t delta[coordinates_per_rectangle] = {};
+    delta[*pos_index] = vec.x();
+    delta[*pos_index + 1] = vec.y();
 
-Position operator+(Position point, const Vector &vec) {
-    return point += vec;
+    static const translate_kernel_t kernel = select_translate_kernel();
+    kernel(reinterpret_cast<Vector::coordinate_t *>(rects), count, delta);
 }
 
-Position operator+(const Vector &vec, Position point) {
-    return point += vec;
-}
+void detail::reflect_all(Rectangle *rects, std::size_t count) {
+    if (count == 0)
+        return;
 
-Rectangle operator+(Rectangle rect, const Vector &vec) {
-    return rect += vec;
-}
+    // The pairs swapped by the raw kernels are only the corner and the
+    // dimensions if the corner starts on a pair boundary.
+    const std::optional<std::size_t> pos_index = packed_corner_index(rects[0]);
+    if (!pos_index || *pos_index % 2 != 0) {
+        for (std::size_t i = 0; i < count; ++i) {
+            rects[i] = rects[i].reflection();
+        }
+        return;
+    }
 
-Rectangle operator+(const Vector &vec, Rectangle rect) {
-    return rect += vec;
+    static const reflect_kernel_t kernel = select_reflect_kernel();
+    kernel(reinterpret_cast<Vector::coordinate_t *>(rects), count);
 }
 
-Rectangles operator+(const Rectangles &rects, const Vector &vec) {
-    Rectangles res(rects);
-    res += vec;
-    return res;
-}
 
-Rectangles operator+(const Vector &vec, const Rectangles &rects) {
-    return rects + vec;
-}
+std::optional<Rectangle> merge_unordered(const Rectangles &rectangles) {
+    if (rectangles.size() == 0)
+        return std::nullopt;
 
-Rectangles operator+(Rectangles &&rects, const Vector &vec) {
-    Rectangles res(std::move(rects));
-    res += vec;
-    return res;
-}
+    Vector::coordinate_t x1 = rectangles[0].pos().x(), y1 = rectangles[0].pos().y();
+    Vector::coordinate_t x2 = x1 + rectangles[0].width(), y2 = y1 + rectangles[0].height();
+    for (const Rectangle &rect:rectangles) {
+        x1 = std::min(x1, rect.pos().x());
+        y1 = std::min(y1, rect.pos().y());
+        x2 = std::max(x2, rect.pos().x() + rect.width());
+        y2 = std::max(y2, rect.pos().y() + rect.height());
+    }
+    const Rectangle bounds(x2 - x1, y2 - y1, Position(x1, y1));
+    if (!GuillotineTiling(rectangles).tiles(bounds))
+        return std::nullopt;
+    return bounds;
+}
+
+Rectangles coalesce(Rectangles rects) {
+    std::vector<bool> alive(rects.size(), true);
+
+    EdgeMultimap by_bottom, by_top, by_left, by_right;
+    for (EdgeMultimap *edges:{&by_bottom, &by_top, &by_left, &by_right})
+        edges->reserve(rects.size());
+    auto link = [&](std::size_t i) {
+        const Rectangle &rect = rects.unchecked(i);
+        by_bottom.emplace(detail::bottom_edge(rect), i);
+        by_top.emplace(detail::top_edge(rect), i);
+        by_left.emplace(detail::left_edge(rect), i);
+        by_right.emplace(detail::right_edge(rect), i);
+    };
+    auto unlink = [&](std::size_t i) {
+        const Rectangle &rect = rects.unchecked(i);
+        erase_edge(by_bottom, detail::bottom_edge(rect), i);
+        erase_edge(by_top, detail::top_edge(rect), i);
+        erase_edge(by_left, detail::left_edge(rect), i);
+        erase_edge(by_right, detail::right_edge(rect), i);
+    };
+    // A live rectangle sharing a whole edge with rects[i], and their merge.
+    auto neighbour = [&](std::size_t i) -> std::optional<std::pair<std::size_t, Rectangle>> {
+        const Rectangle &rect = rects.unchecked(i);
+        if (auto it = by_top.find(detail::bottom_edge(rect)); it != by_top.end()) {
+            return std::make_pair(it->second, detail::merge_horizontally_helper<Vector::coordinate_t>(
+                    rects.unchecked(it->second), rect));
+        }
+        if (auto it = by_bottom.find(detail::top_edge(rect)); it != by_bottom.end()) {
+            return std::make_pair(it->second, detail::merge_horizontally_helper<Vector::coordinate_t>(
+                    rect, rects.unchecked(it->second)));
+        }
+        if (auto it = by_right.find(detail::left_edge(rect)); it != by_right.end()) {
+            return std::make_pair(it->second, detail::merge_vertically_helper<Vector::coordinate_t>(
+                    rects.unchecked(it->second), rect));
+        }
+        if (auto it = by_left.find(detail::right_edge(rect)); it != by_left.end()) {
+            return std::make_pair(it->second, detail::merge_vertically_helper<Vector::coordinate_t>(
+                    rect, rects.unchecked(it->second)));
+        }
+        return std::nullopt;
+    };
+
+    // Only a rectangle that just grew can have gained a neighbour, so each
+    // one is probed until it has none left, and every merge is found in
+    // O(1) expected time. The merge takes the place of its first part.
+    for (std::size_t i = 0; i < rects.size(); ++i)
+        link(i);
+    for (std::size_t i = 0; i < rects.size(); ++i) {
+        if (!alive[i])
+            continue;
+        std::size_t curr = i;
+        while (auto found = neighbour(curr)) {
+            const std::size_t other = found->first;
+            unlink(curr);
+            unlink(other);
+            const std::size_t kept = std::min(curr, other);
+            alive[std::max(curr, other)] = false;
+            rects.unchecked(kept) = found->second;
+            link(kept);
+            curr = kept;
+        }
+    }
 
-Rectangles operator+(const Vector &vec, Rectangles &&rects) {
-    return std::move(rects) + vec;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < rects.size(); ++i) {
+        if (alive[i])
+            rects.unchecked(kept++) = rects.unchecked(i);
+    }
+    rects.erase(rects.begin() + static_cast<std::ptrdiff_t>(kept), rects.end());
+    return rects;
 }
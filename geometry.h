@@ -1,33 +1,51 @@
 #ifndef JNP1_3_GEOMETRY_H
 #define JNP1_3_GEOMETRY_H
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 #include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
-class Position;
+// The geometry classes are templates over the coordinate type T; Vector,
+// Position, Rectangle and Rectangles are the int_fast32_t instantiations.
 
-class Vector {
+template<typename T>
+class basic_position;
+
+template<typename T>
+class basic_vector {
 public:
-    using coordinate_t = int_fast32_t;
+    using coordinate_t = T;
 
-    Vector(coordinate_t x, coordinate_t y);
+    constexpr basic_vector(coordinate_t x, coordinate_t y);
 
-    Vector(const Vector &other) = default;
+    constexpr basic_vector(const basic_vector &other) = default;
 
-    Vector &operator=(const Vector &other) = default;
+    constexpr basic_vector &operator=(const basic_vector &other) = default;
 
-    explicit Vector(const Position &point);
+    constexpr explicit basic_vector(const basic_position<T> &point);
 
-    [[nodiscard]] coordinate_t x() const;
+    [[nodiscard]] constexpr coordinate_t x() const;
 
-    [[nodiscard]] coordinate_t y() const;
+    [[nodiscard]] constexpr coordinate_t y() const;
 
-    [[nodiscard]] Vector reflection() const;
+    [[nodiscard]] constexpr basic_vector reflection() const;
 
-    bool operator==(const Vector &other) const;
+    constexpr bool operator==(const basic_vector &other) const;
 
-    Vector &operator+=(const Vector &other);
+    constexpr basic_vector &operator+=(const basic_vector &other);
 
 private:
     coordinate_t _x;
@@ -35,120 +53,1335 @@ private:
 };
 
 
-class Position {
+template<typename T>
+class basic_position {
 public:
-    Position(Vector::coordinate_t x, Vector::coordinate_t y);
+    constexpr basic_position(T x, T y);
 
-    Position(const Position &other) = default;
+    constexpr basic_position(const basic_position &other) = default;
 
-    Position &operator=(const Position &other) = default;
+    constexpr basic_position &operator=(const basic_position &other) = default;
 
-    explicit Position(const Vector &vec);
+    constexpr explicit basic_position(const basic_vector<T> &vec);
 
-    [[nodiscard]] Vector::coordinate_t x() const;
+    [[nodiscard]] constexpr T x() const;
 
-    [[nodiscard]] Vector::coordinate_t y() const;
+    [[nodiscard]] constexpr T y() const;
 
-    [[nodiscard]] Position reflection() const;
+    [[nodiscard]] constexpr basic_position reflection() const;
 
-    bool operator==(const Position &other) const;
+    constexpr bool operator==(const basic_position &other) const;
 
-    Position &operator+=(const Vector &vec);
+    constexpr basic_position &operator+=(const basic_vector<T> &vec);
 
-    static const Position &origin();
+    static constexpr const basic_position &origin();
 
 private:
-    Vector _vec;
+    static const basic_position _origin;
+
+    basic_vector<T> _vec;
 };
 
 
-class Rectangle {
+namespace detail {
+    // Unsigned counterpart of the product of two integral coordinates,
+    // the coordinate type itself otherwise.
+    template<typename T, bool = std::is_integral_v<T>>
+    struct area_type {
+        using type = T;
+    };
+
+    template<typename T>
+    struct area_type<T, true> {
+        using type = std::make_unsigned_t<decltype(std::declval<T>() * std::declval<T>())>;
+    };
+}
+
+template<typename T>
+class basic_rectangle {
 public:
-    using area_t = uint_fast32_t;
+    using area_t = typename detail::area_type<T>::type;
 
-    using dimension_t = int_fast32_t;
+    using dimension_t = T;
 
-    Rectangle(dimension_t width, dimension_t height, const Position &pos = Position::origin());
+    constexpr basic_rectangle(dimension_t width, dimension_t height,
+                              const basic_position<T> &pos = basic_position<T>::origin());
 
-    Rectangle(const Rectangle &other) = default;
+    constexpr basic_rectangle(const basic_rectangle &other) = default;
 
-    Rectangle &operator=(const Rectangle &other) = default;
+    constexpr basic_rectangle &operator=(const basic_rectangle &other) = default;
 
-    bool operator==(const Rectangle &rect) const;
+    constexpr bool operator==(const basic_rectangle &rect) const;
 
-    [[nodiscard]] const Position &pos() const;
+    [[nodiscard]] constexpr const basic_position<T> &pos() const;
 
-    [[nodiscard]] dimension_t width() const;
+    [[nodiscard]] constexpr dimension_t width() const;
 
-    [[nodiscard]] dimension_t height() const;
+    [[nodiscard]] constexpr dimension_t height() const;
 
-    [[nodiscard]] Rectangle reflection() const;
+    [[nodiscard]] constexpr basic_rectangle reflection() const;
 
-    Rectangle &operator+=(const Vector &vec);
+    constexpr basic_rectangle &operator+=(const basic_vector<T> &vec);
 
-    [[nodiscard]] area_t area() const;
+    [[nodiscard]] constexpr area_t area() const;
 
 private:
-    Vector::coordinate_t _width;
-    Vector::coordinate_t _height;
-    Position _left_bottom_corner;
+    T _width;
+    T _height;
+    basic_position<T> _left_bottom_corner;
 };
 
 
-class Rectangles {
+namespace detail {
+    // Content hash of a sequence of rectangles, updated in O(1) when
+    // a rectangle is appended or replaced. A rectangle contributes a linear
+    // form of its coordinates weighted by a power of an odd multiplier, so
+    // changing any single coordinate changes the hash. Translating all of
+    // them is O(1) too when coordinates wrap like the 64-bit words the hash
+    // is computed in, see linear.
+    template<typename T>
+    class rectangles_hash {
+    public:
+        // Whether translate() can be used: coordinate arithmetic wraps
+        // modulo 2^64, so a translated coordinate maps to the translated word.
+        static constexpr bool linear = std::is_integral_v<T> && sizeof(T) == sizeof(std::uint64_t);
+
+        rectangles_hash() = default;
+
+        rectangles_hash(const rectangles_hash &other) = default;
+
+        rectangles_hash &operator=(const rectangles_hash &other) = default;
+
+        // The moved-from collection is empty.
+        rectangles_hash(rectangles_hash &&other) noexcept;
+
+        rectangles_hash &operator=(rectangles_hash &&other) noexcept;
+
+        void append(const basic_rectangle<T> &rect);
+
+        // Replaces the i-th of the covered rectangles, which was old_rect.
+        void replace(std::size_t i, const basic_rectangle<T> &old_rect, const basic_rectangle<T> &new_rect);
+
+        // Only available when linear.
+        void translate(const basic_vector<T> &vec);
+
+        // Back to the state of an empty collection.
+        void reset();
+
+        [[nodiscard]] std::size_t value() const;
+
+    private:
+        static constexpr std::uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+
+        static std::uint64_t word(T coordinate);
+
+        static std::uint64_t form(const basic_rectangle<T> &rect);
+
+        std::uint64_t _sum = 0;
+        std::uint64_t _weights = 0;
+        std::size_t _count = 0;
+    };
+}
+
+// Allocator is used for the underlying storage. Copies made by operator+
+// keep the allocator of the source, so translated copies of a collection
+// living in an arena end up in the same arena.
+template<typename T, typename Allocator = std::allocator<basic_rectangle<T>>>
+class basic_rectangles {
 public:
-    using size_t = std::vector<Rectangle>::size_type;
+    using allocator_type = Allocator;
+
+    using size_t = typename std::vector<basic_rectangle<T>, Allocator>::size_type;
+
+    using value_type = basic_rectangle<T>;
+
+    using iterator = typename std::vector<basic_rectangle<T>, Allocator>::iterator;
+
+    using const_iterator = typename std::vector<basic_rectangle<T>, Allocator>::const_iterator;
+
+    basic_rectangles() = default;
+
+    explicit basic_rectangles(const Allocator &alloc);
+
+    basic_rectangles(std::initializer_list<basic_rectangle<T>>, const Allocator &alloc = Allocator());
+
+    explicit basic_rectangles(std::vector<basic_rectangle<T>, Allocator> rects);
+
+    basic_rectangles(const basic_rectangles &other) = default;
+
+    basic_rectangles(const basic_rectangles &other, const Allocator &alloc);
+
+    basic_rectangles &operator=(const basic_rectangles &other) = default;
+
+    basic_rectangles(basic_rectangles &&other) = default;
+
+    basic_rectangles(basic_rectangles &&other, const Allocator &alloc);
+
+    basic_rectangles &operator=(basic_rectangles &&other) = default;
+
+    basic_rectangle<T> &operator[](size_t i);
 
-    Rectangles() = default;
+    const basic_rectangle<T> &operator[](size_t i) const;
 
-    Rectangles(std::initializer_list<Rectangle>);
+    // Element access without the bounds check of operator[].
+    basic_rectangle<T> &unchecked(size_t i);
 
-    Rectangles(const Rectangles &other) = default;
+    const basic_rectangle<T> &unchecked(size_t i) const;
 
-    Rectangles &operator=(const Rectangles &other) = default;
+    // Compares the contents, rejecting early on different sizes.
+    bool operator==(const basic_rectangles &rectangles) const;
 
-    Rectangles(Rectangles &&other) = default;
+    bool operator!=(const basic_rectangles &rectangles) const;
 
-    Rectangles &operator=(Rectangles &&other) = default;
+    // Hash of the contents, computed in one pass. HashedRectangles keeps it
+    // up to date instead, see hashed_rectangles.h.
+    [[nodiscard]] std::size_t hash() const;
 
-    Rectangle &operator[](size_t i);
+    basic_rectangles &operator+=(const basic_vector<T> &vec);
 
-    const Rectangle &operator[](size_t i) const;
+    // Replaces every rectangle with its reflection, in place.
+    void reflect();
 
-    bool operator==(const Rectangles &rectangles);
+    [[nodiscard]] size_t size() const;
 
-    Rectangles &operator+=(const Vector &vec);
+    [[nodiscard]] allocator_type get_allocator() const;
 
-    [[nodiscard]] Rectangles::size_t size() const;
+    [[nodiscard]] bool empty() const;
+
+    [[nodiscard]] size_t capacity() const;
+
+    void reserve(size_t n);
+
+    // Removes all rectangles, keeping the capacity.
+    void clear();
+
+    iterator erase(const_iterator first, const_iterator last);
+
+    // Appended rectangles are copies of value.
+    void resize(size_t n, const basic_rectangle<T> &value);
+
+    void push_back(const basic_rectangle<T> &rect);
+
+    template<typename... Args>
+    basic_rectangle<T> &emplace_back(Args &&... args);
+
+    // The rectangles are stored contiguously, size() of them from data().
+    [[nodiscard]] basic_rectangle<T> *data();
+
+    [[nodiscard]] const basic_rectangle<T> *data() const;
+
+    [[nodiscard]] iterator begin();
+
+    [[nodiscard]] iterator end();
+
+    [[nodiscard]] const_iterator begin() const;
+
+    [[nodiscard]] const_iterator end() const;
+
+    [[nodiscard]] const_iterator cbegin() const;
+
+    [[nodiscard]] const_iterator cend() const;
+
+    // Stores in out the rectangles translated by vec. out is overwritten and
+    // its storage reused, so a frame loop does not allocate once it has grown.
+    // out may be *this.
+    void translate_into(basic_rectangles &out, const basic_vector<T> &vec) const;
+
+    // Stores in out the intersections of the rectangles with viewport,
+    // skipping those outside it. out is overwritten and its storage reused;
+    // it may be *this.
+    void clip(const basic_rectangle<T> &viewport, basic_rectangles &out) const;
+
+    // Stores in out the rectangles overlapping viewport, unchanged. out may
+    // be *this.
+    void cull(const basic_rectangle<T> &viewport, basic_rectangles &out) const;
 
 private:
-    std::vector<Rectangle> _rects;
+    std::vector<basic_rectangle<T>, Allocator> _rects;
 };
 
 
-Rectangle merge_horizontally(const Rectangle &rect1, const Rectangle &rect2);
+// Result of adding a vector to a Rectangles lvalue. Further additions only
+// accumulate the offset; it is applied when an element is read or, in
+// a single pass, when the expression is converted to Rectangles. It can be
+// read, iterated and compared like Rectangles, by value.
+// The expression refers to the source collection instead of copying it:
+// the source has to outlive it, and changes to the source show through.
+// auto r = rects + v; keeps such a reference; Rectangles r = rects + v;
+// makes an independent copy.
+template<typename T, typename Allocator = std::allocator<basic_rectangle<T>>>
+class basic_translated_rectangles {
+public:
+    using size_t = typename basic_rectangles<T, Allocator>::size_t;
+
+    // Yields the translated rectangles by value.
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = basic_rectangle<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = basic_rectangle<T>;
+
+        basic_rectangle<T> operator*() const;
+
+        const_iterator &operator++();
+
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator &other) const;
+
+        bool operator!=(const const_iterator &other) const;
+
+    private:
+        friend class basic_translated_rectangles;
+
+        const_iterator(typename basic_rectangles<T, Allocator>::const_iterator it, const basic_vector<T> &offset);
+
+        typename basic_rectangles<T, Allocator>::const_iterator _it;
+        basic_vector<T> _offset;
+    };
+
+    basic_translated_rectangles(const basic_rectangles<T, Allocator> &rects, const basic_vector<T> &offset);
+
+    basic_rectangle<T> operator[](size_t i) const;
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] bool empty() const;
+
+    [[nodiscard]] const_iterator begin() const;
+
+    [[nodiscard]] const_iterator end() const;
+
+    [[nodiscard]] const basic_rectangles<T, Allocator> &source() const;
+
+    [[nodiscard]] const basic_vector<T> &offset() const;
+
+    basic_translated_rectangles &operator+=(const basic_vector<T> &vec);
+
+    operator basic_rectangles<T, Allocator>() const;
+
+private:
+    const basic_rectangles<T, Allocator> *_rects;
+    basic_vector<T> _offset;
+};
+
+
+using Vector = basic_vector<int_fast32_t>;
+
+using Position = basic_position<int_fast32_t>;
+
+using Rectangle = basic_rectangle<int_fast32_t>;
+
+using Rectangles = basic_rectangles<int_fast32_t>;
+
+using TranslatedRectangles = basic_translated_rectangles<int_fast32_t>;
+
+namespace pmr {
+    template<typename T>
+    using basic_rectangles = ::basic_rectangles<T, std::pmr::polymorphic_allocator<basic_rectangle<T>>>;
+
+    using Rectangles = basic_rectangles<int_fast32_t>;
+}
+
+// Wide enough for the area of any Rectangle and for sums of such areas.
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 wide_area_t;
+#else
+using wide_area_t = std::uintmax_t;
+#endif
+
+// Arithmetic policies for the merges. unchecked_arithmetic uses the plain
+// operators; checked_arithmetic throws std::overflow_error when a sum of
+// integral coordinates does not fit. default_arithmetic is the unchecked
+// one unless JNP1_3_CHECKED_ARITHMETIC is defined.
+struct unchecked_arithmetic {
+    template<typename T>
+    static constexpr T add(T a, T b) {
+        return a + b;
+    }
+};
+
+struct checked_arithmetic {
+    template<typename T>
+    static constexpr T add(T a, T b) {
+        if constexpr (std::is_integral_v<T>) {
+            T res{};
+            if (__builtin_add_overflow(a, b, &res))
+                throw std::overflow_error("geometry: coordinate overflow");
+            return res;
+        } else {
+            return a + b;
+        }
+    }
+};
+
+#ifdef JNP1_3_CHECKED_ARITHMETIC
+using default_arithmetic = checked_arithmetic;
+#else
+using default_arithmetic = unchecked_arithmetic;
+#endif
+
+// Area of an integral rectangle, std::nullopt if it does not fit in area_t.
+template<typename T>
+constexpr std::optional<typename basic_rectangle<T>::area_t> checked_area(const basic_rectangle<T> &rect);
+
+// Area of an integral rectangle, clamped to the maximum of area_t.
+template<typename T>
+constexpr typename basic_rectangle<T>::area_t saturating_area(const basic_rectangle<T> &rect);
+
+// Exact area of an integral rectangle.
+template<typename T>
+constexpr wide_area_t wide_area(const basic_rectangle<T> &rect);
+
+
+template<typename Policy = default_arithmetic, typename T>
+constexpr bool can_be_merged_horizontally(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2);
+
+template<typename Policy = default_arithmetic, typename T>
+constexpr bool can_be_merged_vertically(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2);
+
+template<typename Policy = default_arithmetic, typename T>
+constexpr basic_rectangle<T> merge_horizontally(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2);
+
+template<typename Policy = default_arithmetic, typename T>
+constexpr basic_rectangle<T> merge_vertically(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2);
+
+// A rectangle covers [x, x + width) x [y, y + height), so rectangles sharing
+// only an edge do not intersect.
+template<typename T>
+constexpr bool contains(const basic_rectangle<T> &rect, const basic_position<T> &point);
+
+template<typename T>
+constexpr bool contains(const basic_rectangle<T> &outer, const basic_rectangle<T> &inner);
+
+template<typename T>
+constexpr bool intersects(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2);
+
+template<typename T>
+constexpr std::optional<basic_rectangle<T>> intersection(const basic_rectangle<T> &rect1,
+                                                         const basic_rectangle<T> &rect2);
+
+// The smallest rectangle containing both.
+template<typename T>
+constexpr basic_rectangle<T> bounding_union(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2);
+
+// The default argument lets merge_all({...}) pick Rectangles.
+template<typename Policy = default_arithmetic, typename T = int_fast32_t,
+        typename Allocator = std::allocator<basic_rectangle<T>>>
+basic_rectangle<T> merge_all(const basic_rectangles<T, Allocator> &rectangles);
+
+// Merges the source and translates the result, without touching elements.
+template<typename T, typename Allocator>
+basic_rectangle<T> merge_all(const basic_translated_rectangles<T, Allocator> &rectangles);
+
+// Running state of merge_all, fed one rectangle at a time. Only the
+// accumulated rectangle is kept, so the input never has to be in memory.
+template<typename T, typename Policy = default_arithmetic>
+class basic_merge_accumulator {
+public:
+    // Merges rect into the accumulated rectangle. Returns false and leaves
+    // the state unchanged if the two cannot be merged.
+    bool push(const basic_rectangle<T> &rect);
+
+    // The accumulated rectangle, std::nullopt before the first push.
+    [[nodiscard]] const std::optional<basic_rectangle<T>> &result() const;
+
+    // Number of rectangles merged so far.
+    [[nodiscard]] std::size_t count() const;
+
+private:
+    std::optional<basic_rectangle<T>> _rect;
+    std::size_t _count = 0;
+};
+
+using MergeAccumulator = basic_merge_accumulator<int_fast32_t>;
+
+template<typename T>
+struct basic_merge_result {
+    // The merged rectangle, std::nullopt for an empty input or on failure.
+    std::optional<basic_rectangle<T>> rect;
+    // Index of the first rectangle that could not be merged.
+    std::optional<std::size_t> failed_at;
+};
+
+using MergeResult = basic_merge_result<int_fast32_t>;
+
+// merge_all over [first, last), consumed in a single pass. Stops at the
+// first rectangle that cannot be merged and reports its index.
+template<typename Policy = default_arithmetic, typename InputIt, typename Sentinel>
+auto merge_stream(InputIt first, Sentinel last)
+-> basic_merge_result<typename std::decay_t<decltype(*first)>::dimension_t>;
+
+template<typename Policy = default_arithmetic, typename Range>
+auto merge_stream(Range &&range)
+-> decltype(merge_stream<Policy>(std::begin(range), std::end(range)));
+
+// Merges rectangles given in any order, as long as together they form
+// a guillotine tiling of a rectangle. Returns std::nullopt otherwise.
+// Takes O(n log^2 n) time at worst.
+std::optional<Rectangle> merge_unordered(const Rectangles &rectangles);
+
+// Repeatedly merges pairs of rectangles that can be merged horizontally or
+// vertically until no such pair is left. Surviving rectangles keep their
+// relative order. Works in the storage of its argument, so passing an
+// rvalue avoids copying the rectangles.
+Rectangles coalesce(Rectangles rectangles);
+
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> operator+(basic_rectangles<T, Allocator> &&rects, const basic_vector<T> &vec);
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> operator+(const basic_vector<T> &vec, basic_rectangles<T, Allocator> &&rects);
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(const basic_rectangles<T, Allocator> &rects,
+                                                    const basic_vector<T> &vec);
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(const basic_vector<T> &vec,
+                                                    const basic_rectangles<T, Allocator> &rects);
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(basic_translated_rectangles<T, Allocator> rects,
+                                                    const basic_vector<T> &vec);
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(const basic_vector<T> &vec,
+                                                    basic_translated_rectangles<T, Allocator> rects);
+
+// Compare the translated rectangles, without materializing them.
+template<typename T, typename Allocator>
+bool operator==(const basic_translated_rectangles<T, Allocator> &lhs,
+                const basic_translated_rectangles<T, Allocator> &rhs);
+
+template<typename T, typename Allocator>
+bool operator==(const basic_translated_rectangles<T, Allocator> &lhs, const basic_rectangles<T, Allocator> &rhs);
+
+template<typename T, typename Allocator>
+bool operator==(const basic_rectangles<T, Allocator> &lhs, const basic_translated_rectangles<T, Allocator> &rhs);
+
+template<typename T, typename Allocator>
+bool operator!=(const basic_translated_rectangles<T, Allocator> &lhs,
+                const basic_translated_rectangles<T, Allocator> &rhs);
+
+template<typename T, typename Allocator>
+bool operator!=(const basic_translated_rectangles<T, Allocator> &lhs, const basic_rectangles<T, Allocator> &rhs);
+
+template<typename T, typename Allocator>
+bool operator!=(const basic_rectangles<T, Allocator> &lhs, const basic_translated_rectangles<T, Allocator> &rhs);
+
+template<typename T>
+constexpr basic_rectangle<T> operator+(basic_rectangle<T> rect, const basic_vector<T> &vec);
+
+template<typename T>
+constexpr basic_rectangle<T> operator+(const basic_vector<T> &vec, basic_rectangle<T> rect);
+
+template<typename T>
+constexpr basic_vector<T> operator+(basic_vector<T> vec1, const basic_vector<T> &vec2);
 
-Rectangle merge_vertically(const Rectangle &rect1, const Rectangle &rect2);
+template<typename T>
+constexpr basic_position<T> operator+(basic_position<T> point, const basic_vector<T> &vec);
 
-Rectangle merge_all(const Rectangles &rectangles);
+template<typename T>
+constexpr basic_position<T> operator+(const basic_vector<T> &vec, basic_position<T> point);
 
 
-Rectangles operator+(Rectangles &&rects, const Vector &vec);
+template<typename T>
+constexpr basic_vector<T>::basic_vector(T x, T y) : _x(x), _y(y) {}
 
-Rectangles operator+(const Vector &vec, Rectangles &&rects);
+template<typename T>
+constexpr basic_vector<T>::basic_vector(const basic_position<T> &point) : _x(point.x()), _y(point.y()) {}
 
-Rectangles operator+(const Rectangles &rects, const Vector &vec);
+template<typename T>
+constexpr T basic_vector<T>::x() const {
+    return this->_x;
+}
 
-Rectangles operator+(const Vector &vec, const Rectangles &rects);
+template<typename T>
+constexpr T basic_vector<T>::y() const {
+    return this->_y;
+}
 
-Rectangle operator+(Rectangle rect, const Vector &vec);
+template<typename T>
+constexpr basic_vector<T> basic_vector<T>::reflection() const {
+    return basic_vector(this->_y, this->_x);
+}
 
-Rectangle operator+(const Vector &vec, Rectangle rect);
+template<typename T>
+constexpr bool basic_vector<T>::operator==(const basic_vector &other) const {
+    return this->_x == other._x && this->_y == other._y;
+}
+
+template<typename T>
+constexpr basic_vector<T> &basic_vector<T>::operator+=(const basic_vector &other) {
+    this->_x += other._x;
+    this->_y += other._y;
+    return *this;
+}
 
-Vector operator+(Vector vec1, const Vector &vec2);
 
-Position operator+(Position point, const Vector &vec);
+template<typename T>
+constexpr basic_position<T>::basic_position(T x, T y) : _vec(x, y) {}
+
+template<typename T>
+constexpr basic_position<T>::basic_position(const basic_vector<T> &vec) : _vec(vec) {}
 
-Position operator+(const Vector &vec, Position point);
+template<typename T>
+inline constexpr basic_position<T> basic_position<T>::_origin = basic_position<T>(0, 0);
+
+template<typename T>
+constexpr const basic_position<T> &basic_position<T>::origin() {
+    return _origin;
+}
+
+template<typename T>
+constexpr T basic_position<T>::x() const {
+    return this->_vec.x();
+}
+
+template<typename T>
+constexpr T basic_position<T>::y() const {
+    return this->_vec.y();
+}
+
+template<typename T>
+constexpr basic_position<T> basic_position<T>::reflection() const {
+    return basic_position(this->_vec.reflection());
+}
+
+template<typename T>
+constexpr bool basic_position<T>::operator==(const basic_position &other) const {
+    return this->_vec == other._vec;
+}
+
+template<typename T>
+constexpr basic_position<T> &basic_position<T>::operator+=(const basic_vector<T> &vector) {
+    this->_vec += vector;
+    return *this;
+}
+
+
+template<typename T>
+constexpr basic_rectangle<T>::basic_rectangle(T width, T height, const basic_position<T> &pos)
+        : _width(width), _height(height), _left_bottom_corner(pos) {
+    assert(width > 0 && height > 0);
+}
+
+template<typename T>
+constexpr bool basic_rectangle<T>::operator==(const basic_rectangle &rect) const {
+    return this->_left_bottom_corner == rect._left_bottom_corner
+           && this->width() == rect.width()
+           && this->height() == rect.height();
+}
+
+template<typename T>
+constexpr const basic_position<T> &basic_rectangle<T>::pos() const {
+    return this->_left_bottom_corner;
+}
+
+template<typename T>
+constexpr T basic_rectangle<T>::width() const {
+    return this->_width;
+}
+
+template<typename T>
+constexpr T basic_rectangle<T>::height() const {
+    return this->_height;
+}
+
+template<typename T>
+constexpr basic_rectangle<T> basic_rectangle<T>::reflection() const {
+    return basic_rectangle(this->height(), this->width(), this->pos().reflection());
+}
+
+template<typename T>
+constexpr basic_rectangle<T> &basic_rectangle<T>::operator+=(const basic_vector<T> &vec) {
+    this->_left_bottom_corner += vec;
+    return *this;
+}
+
+template<typename T>
+constexpr typename basic_rectangle<T>::area_t basic_rectangle<T>::area() const {
+    return this->width() * this->height();
+}
+
+
+namespace detail {
+    template<typename T>
+    void translate_all(basic_rectangle<T> *rects, std::size_t count, const basic_vector<T> &vec) {
+        for (std::size_t i = 0; i < count; ++i) {
+            rects[i] += vec;
+        }
+    }
+
+    // Vectorized for the default coordinate type, see geometry.cc.
+    void translate_all(Rectangle *rects, std::size_t count, const Vector &vec);
+
+    template<typename T>
+    void reflect_all(basic_rectangle<T> *rects, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            rects[i] = rects[i].reflection();
+        }
+    }
+
+    // Vectorized for the default coordinate type, see geometry.cc.
+    void reflect_all(Rectangle *rects, std::size_t count);
+
+    template<typename T>
+    rectangles_hash<T>::rectangles_hash(rectangles_hash &&other) noexcept
+            : _sum(other._sum), _weights(other._weights), _count(other._count) {
+        other.reset();
+    }
+
+    template<typename T>
+    rectangles_hash<T> &rectangles_hash<T>::operator=(rectangles_hash &&other) noexcept {
+        *this = static_cast<const rectangles_hash &>(other);
+        if (this != &other)
+            other.reset();
+        return *this;
+    }
+
+    template<typename T>
+    std::uint64_t rectangles_hash<T>::word(T coordinate) {
+        if constexpr (std::is_integral_v<T>) {
+            return static_cast<std::uint64_t>(coordinate);
+        } else {
+            return std::hash<T>()(coordinate);
+        }
+    }
+
+    template<typename T>
+    std::uint64_t rectangles_hash<T>::form(const basic_rectangle<T> &rect) {
+        return word(rect.pos().x()) * 0xbf58476d1ce4e5b9ULL + word(rect.pos().y()) * 0x94d049bb133111ebULL
+               + word(rect.width()) * 0xd6e8feb86659fd93ULL + word(rect.height()) * 0xa0761d6478bd642fULL;
+    }
+
+    template<typename T>
+    void rectangles_hash<T>::append(const basic_rectangle<T> &rect) {
+        this->_sum = this->_sum * multiplier + form(rect);
+        this->_weights = this->_weights * multiplier + 1;
+        ++this->_count;
+    }
+
+    template<typename T>
+    void rectangles_hash<T>::replace(std::size_t i, const basic_rectangle<T> &old_rect,
+                                     const basic_rectangle<T> &new_rect) {
+        assert(i < this->_count);
+        std::uint64_t weight = 1, power = multiplier;
+        for (std::size_t e = this->_count - 1 - i; e != 0; e >>= 1) {
+            if (e & 1)
+                weight *= power;
+            power *= power;
+        }
+        this->_sum += (form(new_rect) - form(old_rect)) * weight;
+    }
+
+    template<typename T>
+    void rectangles_hash<T>::translate(const basic_vector<T> &vec) {
+        static_assert(linear, "translate() needs coordinates wrapping like 64-bit words");
+        this->_sum += (word(vec.x()) * 0xbf58476d1ce4e5b9ULL + word(vec.y()) * 0x94d049bb133111ebULL)
+                      * this->_weights;
+    }
+
+    template<typename T>
+    void rectangles_hash<T>::reset() {
+        this->_sum = 0;
+        this->_weights = 0;
+        this->_count = 0;
+    }
+
+    template<typename T>
+    std::size_t rectangles_hash<T>::value() const {
+        std::uint64_t h = this->_sum ^ this->_count * multiplier;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<std::size_t>(h ^ (h >> 31));
+    }
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator>::basic_rectangles(const Allocator &alloc) : _rects(alloc) {}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator>::basic_rectangles(std::initializer_list<basic_rectangle<T>> rects,
+                                                 const Allocator &alloc) : _rects(rects, alloc) {}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator>::basic_rectangles(std::vector<basic_rectangle<T>, Allocator> rects)
+        : _rects(std::move(rects)) {}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator>::basic_rectangles(const basic_rectangles &other, const Allocator &alloc)
+        : _rects(other._rects, alloc) {}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator>::basic_rectangles(basic_rectangles &&other, const Allocator &alloc)
+        : _rects(std::move(other._rects), alloc) {}
+
+template<typename T, typename Allocator>
+bool basic_rectangles<T, Allocator>::operator==(const basic_rectangles &rectangles) const {
+    if (this->size() != rectangles.size())
+        return false;
+    if constexpr (std::has_unique_object_representations_v<basic_rectangle<T>>) {
+        return this->_rects.empty()
+               || std::memcmp(this->_rects.data(), rectangles._rects.data(),
+                              this->_rects.size() * sizeof(basic_rectangle<T>)) == 0;
+    } else {
+        return std::equal(this->_rects.begin(), this->_rects.end(), rectangles._rects.begin());
+    }
+}
+
+template<typename T, typename Allocator>
+bool basic_rectangles<T, Allocator>::operator!=(const basic_rectangles &rectangles) const {
+    return !(*this == rectangles);
+}
+
+template<typename T, typename Allocator>
+std::size_t basic_rectangles<T, Allocator>::hash() const {
+    detail::rectangles_hash<T> res;
+    for (const basic_rectangle<T> &rect:this->_rects)
+        res.append(rect);
+    return res.value();
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> &basic_rectangles<T, Allocator>::operator+=(const basic_vector<T> &vec) {
+    detail::translate_all(this->_rects.data(), this->_rects.size(), vec);
+    return *this;
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::reflect() {
+    detail::reflect_all(this->_rects.data(), this->_rects.size());
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::size_t basic_rectangles<T, Allocator>::size() const {
+    return this->_rects.size();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::allocator_type basic_rectangles<T, Allocator>::get_allocator() const {
+    return this->_rects.get_allocator();
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::translate_into(basic_rectangles &out, const basic_vector<T> &vec) const {
+    if (&out != this)
+        out._rects.assign(this->_rects.begin(), this->_rects.end());
+    out += vec;
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::clip(const basic_rectangle<T> &viewport, basic_rectangles &out) const {
+    // Branch-free compaction: every candidate is written to the next free
+    // slot, which only advances when the candidate is kept.
+    const T vx1 = viewport.pos().x(), vy1 = viewport.pos().y();
+    const T vx2 = vx1 + viewport.width(), vy2 = vy1 + viewport.height();
+    // In place, the write lags behind the read, so no slot is overwritten
+    // before it is read.
+    if (&out != this)
+        out._rects.assign(this->_rects.size(), viewport);
+    size_t kept = 0;
+    for (const basic_rectangle<T> &rect:this->_rects) {
+        const T x1 = std::max(rect.pos().x(), vx1);
+        const T y1 = std::max(rect.pos().y(), vy1);
+        const T width = std::min(rect.pos().x() + rect.width(), vx2) - x1;
+        const T height = std::min(rect.pos().y() + rect.height(), vy2) - y1;
+        const bool keep = (width > 0) & (height > 0);
+        out._rects[kept] = basic_rectangle<T>(keep ? width : 1, keep ? height : 1, basic_position<T>(x1, y1));
+        kept += keep;
+    }
+    out._rects.erase(out._rects.begin() + static_cast<std::ptrdiff_t>(kept), out._rects.end());
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::cull(const basic_rectangle<T> &viewport, basic_rectangles &out) const {
+    if (&out != this)
+        out._rects.assign(this->_rects.size(), viewport);
+    size_t kept = 0;
+    for (const basic_rectangle<T> &rect:this->_rects) {
+        out._rects[kept] = rect;
+        kept += intersects(rect, viewport);
+    }
+    out._rects.erase(out._rects.begin() + static_cast<std::ptrdiff_t>(kept), out._rects.end());
+}
+
+template<typename T, typename Allocator>
+const basic_rectangle<T> &basic_rectangles<T, Allocator>::operator[](size_t i) const {
+    return this->_rects.at(i);
+}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> &basic_rectangles<T, Allocator>::operator[](size_t i) {
+    return this->_rects.at(i);
+}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> &basic_rectangles<T, Allocator>::unchecked(size_t i) {
+    return this->_rects[i];
+}
+
+template<typename T, typename Allocator>
+const basic_rectangle<T> &basic_rectangles<T, Allocator>::unchecked(size_t i) const {
+    return this->_rects[i];
+}
+
+template<typename T, typename Allocator>
+bool basic_rectangles<T, Allocator>::empty() const {
+    return this->_rects.empty();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::size_t basic_rectangles<T, Allocator>::capacity() const {
+    return this->_rects.capacity();
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::reserve(size_t n) {
+    this->_rects.reserve(n);
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::clear() {
+    this->_rects.clear();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::iterator
+basic_rectangles<T, Allocator>::erase(const_iterator first, const_iterator last) {
+    return this->_rects.erase(first, last);
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::resize(size_t n, const basic_rectangle<T> &value) {
+    this->_rects.resize(n, value);
+}
+
+template<typename T, typename Allocator>
+void basic_rectangles<T, Allocator>::push_back(const basic_rectangle<T> &rect) {
+    this->_rects.push_back(rect);
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+basic_rectangle<T> &basic_rectangles<T, Allocator>::emplace_back(Args &&... args) {
+    return this->_rects.emplace_back(std::forward<Args>(args)...);
+}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> *basic_rectangles<T, Allocator>::data() {
+    return this->_rects.data();
+}
+
+template<typename T, typename Allocator>
+const basic_rectangle<T> *basic_rectangles<T, Allocator>::data() const {
+    return this->_rects.data();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::iterator basic_rectangles<T, Allocator>::begin() {
+    return this->_rects.begin();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::iterator basic_rectangles<T, Allocator>::end() {
+    return this->_rects.end();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::const_iterator basic_rectangles<T, Allocator>::begin() const {
+    return this->_rects.begin();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::const_iterator basic_rectangles<T, Allocator>::end() const {
+    return this->_rects.end();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::const_iterator basic_rectangles<T, Allocator>::cbegin() const {
+    return this->_rects.cbegin();
+}
+
+template<typename T, typename Allocator>
+typename basic_rectangles<T, Allocator>::const_iterator basic_rectangles<T, Allocator>::cend() const {
+    return this->_rects.cend();
+}
+
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator>::const_iterator::const_iterator(
+        typename basic_rectangles<T, Allocator>::const_iterator it, const basic_vector<T> &offset)
+        : _it(it), _offset(offset) {}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> basic_translated_rectangles<T, Allocator>::const_iterator::operator*() const {
+    return *this->_it + this->_offset;
+}
+
+template<typename T, typename Allocator>
+typename basic_translated_rectangles<T, Allocator>::const_iterator &
+basic_translated_rectangles<T, Allocator>::const_iterator::operator++() {
+    ++this->_it;
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename basic_translated_rectangles<T, Allocator>::const_iterator
+basic_translated_rectangles<T, Allocator>::const_iterator::operator++(int) {
+    const_iterator res(*this);
+    ++this->_it;
+    return res;
+}
+
+template<typename T, typename Allocator>
+bool basic_translated_rectangles<T, Allocator>::const_iterator::operator==(const const_iterator &other) const {
+    return this->_it == other._it;
+}
+
+template<typename T, typename Allocator>
+bool basic_translated_rectangles<T, Allocator>::const_iterator::operator!=(const const_iterator &other) const {
+    return !(*this == other);
+}
+
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator>::basic_translated_rectangles(const basic_rectangles<T, Allocator> &rects,
+                                                                       const basic_vector<T> &offset)
+        : _rects(&rects), _offset(offset) {}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> basic_translated_rectangles<T, Allocator>::operator[](size_t i) const {
+    return (*this->_rects)[i] + this->_offset;
+}
+
+template<typename T, typename Allocator>
+typename basic_translated_rectangles<T, Allocator>::size_t basic_translated_rectangles<T, Allocator>::size() const {
+    return this->_rects->size();
+}
+
+template<typename T, typename Allocator>
+bool basic_translated_rectangles<T, Allocator>::empty() const {
+    return this->_rects->empty();
+}
+
+template<typename T, typename Allocator>
+typename basic_translated_rectangles<T, Allocator>::const_iterator
+basic_translated_rectangles<T, Allocator>::begin() const {
+    return const_iterator(this->_rects->begin(), this->_offset);
+}
+
+template<typename T, typename Allocator>
+typename basic_translated_rectangles<T, Allocator>::const_iterator
+basic_translated_rectangles<T, Allocator>::end() const {
+    return const_iterator(this->_rects->end(), this->_offset);
+}
+
+template<typename T, typename Allocator>
+const basic_rectangles<T, Allocator> &basic_translated_rectangles<T, Allocator>::source() const {
+    return *this->_rects;
+}
+
+template<typename T, typename Allocator>
+const basic_vector<T> &basic_translated_rectangles<T, Allocator>::offset() const {
+    return this->_offset;
+}
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> &
+basic_translated_rectangles<T, Allocator>::operator+=(const basic_vector<T> &vec) {
+    this->_offset += vec;
+    return *this;
+}
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator>::operator basic_rectangles<T, Allocator>() const {
+    basic_rectangles<T, Allocator> res(*this->_rects, this->_rects->get_allocator());
+    res += this->_offset;
+    return res;
+}
+
+
+namespace detail {
+    template<typename T, typename Policy = default_arithmetic>
+    constexpr basic_rectangle<T> merge_vertically_helper(const basic_rectangle<T> &rect1,
+                                                         const basic_rectangle<T> &rect2) {
+        T new_width = Policy::add(rect1.width(), rect2.width());
+        T new_height = rect1.height();
+        return basic_rectangle<T>(new_width, new_height, rect1.pos());
+    }
+
+    template<typename T, typename Policy = default_arithmetic>
+    constexpr basic_rectangle<T> merge_horizontally_helper(const basic_rectangle<T> &rect1,
+                                                           const basic_rectangle<T> &rect2) {
+        T new_width = rect1.width();
+        T new_height = Policy::add(rect1.height(), rect2.height());
+        return basic_rectangle<T>(new_width, new_height, rect1.pos());
+    }
+}
+
+template<typename Policy, typename T>
+constexpr bool can_be_merged_horizontally(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2) {
+    return rect1.width() == rect2.width()
+           && rect1.pos().x() == rect2.pos().x()
+           && Policy::add(rect1.pos().y(), rect1.height()) == rect2.pos().y();
+}
+
+template<typename Policy, typename T>
+constexpr bool can_be_merged_vertically(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2) {
+    return rect1.height() == rect2.height()
+           && rect1.pos().y() == rect2.pos().y()
+           && Policy::add(rect1.pos().x(), rect1.width()) == rect2.pos().x();
+}
+
+template<typename Policy, typename T>
+constexpr basic_rectangle<T> merge_vertically(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2) {
+    assert(can_be_merged_vertically<Policy>(rect1, rect2));
+    return detail::merge_vertically_helper<T, Policy>(rect1, rect2);
+}
+
+template<typename Policy, typename T>
+constexpr basic_rectangle<T> merge_horizontally(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2) {
+    assert(can_be_merged_horizontally<Policy>(rect1, rect2));
+    return detail::merge_horizontally_helper<T, Policy>(rect1, rect2);
+}
+
+template<typename T>
+constexpr std::optional<typename basic_rectangle<T>::area_t> checked_area(const basic_rectangle<T> &rect) {
+    static_assert(std::is_integral_v<T>, "checked_area needs integral coordinates");
+    typename basic_rectangle<T>::area_t res{};
+    if (__builtin_mul_overflow(rect.width(), rect.height(), &res))
+        return std::nullopt;
+    return res;
+}
+
+template<typename T>
+constexpr typename basic_rectangle<T>::area_t saturating_area(const basic_rectangle<T> &rect) {
+    static_assert(std::is_integral_v<T>, "saturating_area needs integral coordinates");
+    typename basic_rectangle<T>::area_t res{};
+    if (__builtin_mul_overflow(rect.width(), rect.height(), &res))
+        return std::numeric_limits<typename basic_rectangle<T>::area_t>::max();
+    return res;
+}
+
+template<typename T>
+constexpr wide_area_t wide_area(const basic_rectangle<T> &rect) {
+    static_assert(std::is_integral_v<T>, "wide_area needs integral coordinates");
+    return static_cast<wide_area_t>(rect.width()) * static_cast<wide_area_t>(rect.height());
+}
+
+template<typename T>
+constexpr bool contains(const basic_rectangle<T> &rect, const basic_position<T> &point) {
+    return (rect.pos().x() <= point.x()) & (point.x() < rect.pos().x() + rect.width())
+           & (rect.pos().y() <= point.y()) & (point.y() < rect.pos().y() + rect.height());
+}
+
+template<typename T>
+constexpr bool contains(const basic_rectangle<T> &outer, const basic_rectangle<T> &inner) {
+    return (outer.pos().x() <= inner.pos().x())
+           & (inner.pos().x() + inner.width() <= outer.pos().x() + outer.width())
+           & (outer.pos().y() <= inner.pos().y())
+           & (inner.pos().y() + inner.height() <= outer.pos().y() + outer.height());
+}
+
+template<typename T>
+constexpr bool intersects(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2) {
+    return (rect1.pos().x() < rect2.pos().x() + rect2.width())
+           & (rect2.pos().x() < rect1.pos().x() + rect1.width())
+           & (rect1.pos().y() < rect2.pos().y() + rect2.height())
+           & (rect2.pos().y() < rect1.pos().y() + rect1.height());
+}
+
+template<typename T>
+constexpr std::optional<basic_rectangle<T>> intersection(const basic_rectangle<T> &rect1,
+                                                         const basic_rectangle<T> &rect2) {
+    const T x1 = std::max(rect1.pos().x(), rect2.pos().x());
+    const T y1 = std::max(rect1.pos().y(), rect2.pos().y());
+    const T width = std::min(rect1.pos().x() + rect1.width(), rect2.pos().x() + rect2.width()) - x1;
+    const T height = std::min(rect1.pos().y() + rect1.height(), rect2.pos().y() + rect2.height()) - y1;
+    if (width <= 0 || height <= 0)
+        return std::nullopt;
+    return basic_rectangle<T>(width, height, basic_position<T>(x1, y1));
+}
+
+template<typename T>
+constexpr basic_rectangle<T> bounding_union(const basic_rectangle<T> &rect1, const basic_rectangle<T> &rect2) {
+    const T x1 = std::min(rect1.pos().x(), rect2.pos().x());
+    const T y1 = std::min(rect1.pos().y(), rect2.pos().y());
+    const T x2 = std::max(rect1.pos().x() + rect1.width(), rect2.pos().x() + rect2.width());
+    const T y2 = std::max(rect1.pos().y() + rect1.height(), rect2.pos().y() + rect2.height());
+    return basic_rectangle<T>(x2 - x1, y2 - y1, basic_position<T>(x1, y1));
+}
+
+template<typename Policy, typename T, typename Allocator>
+basic_rectangle<T> merge_all(const basic_rectangles<T, Allocator> &rectangles) {
+    assert(rectangles.size());
+    basic_rectangle<T> rect = rectangles[0];
+    for (typename basic_rectangles<T, Allocator>::size_t i = 1; i < rectangles.size(); ++i) {
+        const basic_rectangle<T> &curr = rectangles.unchecked(i);
+        if (can_be_merged_horizontally<Policy>(rect, curr)) {
+            rect = detail::merge_horizontally_helper<T, Policy>(rect, curr);
+        } else {
+            rect = merge_vertically<Policy>(rect, curr);
+        }
+    }
+
+    return rect;
+}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> merge_all(const basic_translated_rectangles<T, Allocator> &rectangles) {
+    return merge_all(rectangles.source()) + rectangles.offset();
+}
+
+template<typename T, typename Policy>
+bool basic_merge_accumulator<T, Policy>::push(const basic_rectangle<T> &rect) {
+    if (!this->_rect) {
+        this->_rect = rect;
+    } else if (can_be_merged_horizontally<Policy>(*this->_rect, rect)) {
+        this->_rect = detail::merge_horizontally_helper<T, Policy>(*this->_rect, rect);
+    } else if (can_be_merged_vertically<Policy>(*this->_rect, rect)) {
+        this->_rect = detail::merge_vertically_helper<T, Policy>(*this->_rect, rect);
+    } else {
+        return false;
+    }
+    ++this->_count;
+    return true;
+}
+
+template<typename T, typename Policy>
+const std::optional<basic_rectangle<T>> &basic_merge_accumulator<T, Policy>::result() const {
+    return this->_rect;
+}
+
+template<typename T, typename Policy>
+std::size_t basic_merge_accumulator<T, Policy>::count() const {
+    return this->_count;
+}
+
+template<typename Policy, typename InputIt, typename Sentinel>
+auto merge_stream(InputIt first, Sentinel last)
+-> basic_merge_result<typename std::decay_t<decltype(*first)>::dimension_t> {
+    using T = typename std::decay_t<decltype(*first)>::dimension_t;
+    basic_merge_accumulator<T, Policy> acc;
+    for (; first != last; ++first) {
+        if (!acc.push(*first))
+            return {std::nullopt, acc.count()};
+    }
+    return {acc.result(), std::nullopt};
+}
+
+template<typename Policy, typename Range>
+auto merge_stream(Range &&range)
+-> decltype(merge_stream<Policy>(std::begin(range), std::end(range))) {
+    return merge_stream<Policy>(std::begin(range), std::end(range));
+}
+
+
+template<typename T>
+constexpr basic_vector<T> operator+(basic_vector<T> vec1, const basic_vector<T> &vec2) {
+    return vec1 += vec2;
+}
+
+template<typename T>
+constexpr basic_position<T> operator+(basic_position<T> point, const basic_vector<T> &vec) {
+    return point += vec;
+}
+
+template<typename T>
+constexpr basic_position<T> operator+(const basic_vector<T> &vec, basic_position<T> point) {
+    return point += vec;
+}
+
+template<typename T>
+constexpr basic_rectangle<T> operator+(basic_rectangle<T> rect, const basic_vector<T> &vec) {
+    return rect += vec;
+}
+
+template<typename T>
+constexpr basic_rectangle<T> operator+(const basic_vector<T> &vec, basic_rectangle<T> rect) {
+    return rect += vec;
+}
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(const basic_rectangles<T, Allocator> &rects,
+                                                    const basic_vector<T> &vec) {
+    return basic_translated_rectangles<T, Allocator>(rects, vec);
+}
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(const basic_vector<T> &vec,
+                                                    const basic_rectangles<T, Allocator> &rects) {
+    return rects + vec;
+}
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(basic_translated_rectangles<T, Allocator> rects,
+                                                    const basic_vector<T> &vec) {
+    return rects += vec;
+}
+
+template<typename T, typename Allocator>
+basic_translated_rectangles<T, Allocator> operator+(const basic_vector<T> &vec,
+                                                    basic_translated_rectangles<T, Allocator> rects) {
+    return rects += vec;
+}
+
+template<typename T, typename Allocator>
+bool operator==(const basic_translated_rectangles<T, Allocator> &lhs,
+                const basic_translated_rectangles<T, Allocator> &rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template<typename T, typename Allocator>
+bool operator==(const basic_translated_rectangles<T, Allocator> &lhs, const basic_rectangles<T, Allocator> &rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template<typename T, typename Allocator>
+bool operator==(const basic_rectangles<T, Allocator> &lhs, const basic_translated_rectangles<T, Allocator> &rhs) {
+    return rhs == lhs;
+}
+
+template<typename T, typename Allocator>
+bool operator!=(const basic_translated_rectangles<T, Allocator> &lhs,
+                const basic_translated_rectangles<T, Allocator> &rhs) {
+    return !(lhs == rhs);
+}
+
+template<typename T, typename Allocator>
+bool operator!=(const basic_translated_rectangles<T, Allocator> &lhs, const basic_rectangles<T, Allocator> &rhs) {
+    return !(lhs == rhs);
+}
+
+template<typename T, typename Allocator>
+bool operator!=(const basic_rectangles<T, Allocator> &lhs, const basic_translated_rectangles<T, Allocator> &rhs) {
+    return !(lhs == rhs);
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> operator+(basic_rectangles<T, Allocator> &&rects, const basic_vector<T> &vec) {
+    basic_rectangles<T, Allocator> res(std::move(rects));
+    res += vec;
+    return res;
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> operator+(const basic_vector<T> &vec, basic_rectangles<T, Allocator> &&rects) {
+    return std::move(rects) + vec;
+}
+
+namespace std {
+    template<typename T, typename Allocator>
+    struct hash<basic_rectangles<T, Allocator>> {
+        std::size_t operator()(const basic_rectangles<T, Allocator> &rects) const {
+            return rects.hash();
+        }
+    };
+}
 
 #endif //JNP1_3_GEOMETRY_H
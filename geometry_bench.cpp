@@ -0,0 +1,450 @@
+#include "broad_phase.h"
+#include "coverage.h"
+#include "dirty_region.h"
+#include "hashed_rectangles.h"
+#include "parallel.h"
+#include "transform.h"
+#include "geometry.h"
+#include <benchmark/benchmark.h>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Passes allocations on to new and delete, counting them, so that the
+    // allocator benchmarks can report how often a frame reaches the heap.
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        [[nodiscard]] std::size_t allocations() const {
+            return this->_allocations;
+        }
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++this->_allocations;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+        std::size_t _allocations = 0;
+    };
+    std::vector<Rectangle> make_layer(std::size_t n) {
+        std::vector<Rectangle> rects;
+        rects.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto c = static_cast<Vector::coordinate_t>(i);
+            rects.emplace_back(1 + c % 7, 1 + c % 5, Position(c, -c));
+        }
+        return rects;
+    }
+
+    // A single row of tiles which merge_all folds left to right.
+    std::vector<Rectangle> make_row(std::size_t n) {
+        std::vector<Rectangle> rects;
+        rects.reserve(n);
+        Vector::coordinate_t x = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            auto width = static_cast<Vector::coordinate_t>(1 + i % 3);
+            rects.emplace_back(width, 4, Position(x, 0));
+            x += width;
+        }
+        return rects;
+    }
+
+    void BM_VectorAdd(benchmark::State &state) {
+        Vector vec(1, 2);
+        const Vector step(3, -1);
+        for (auto _:state) {
+            vec = vec + step;
+            benchmark::DoNotOptimize(vec);
+        }
+    }
+
+    void BM_VectorReflection(benchmark::State &state) {
+        Vector vec(1, 2);
+        for (auto _:state) {
+            vec = vec.reflection();
+            benchmark::DoNotOptimize(vec);
+        }
+    }
+
+    void BM_PositionAdd(benchmark::State &state) {
+        Position pos(1, 2);
+        const Vector step(3, -1);
+        for (auto _:state) {
+            pos = pos + step;
+            benchmark::DoNotOptimize(pos);
+        }
+    }
+
+    void BM_RectangleAdd(benchmark::State &state) {
+        Rectangle rect(3, 4, {1, 2});
+        const Vector step(3, -1);
+        for (auto _:state) {
+            rect = rect + step;
+            benchmark::DoNotOptimize(rect);
+        }
+    }
+
+    void BM_RectangleReflection(benchmark::State &state) {
+        Rectangle rect(3, 4, {1, 2});
+        for (auto _:state) {
+            rect = rect.reflection();
+            benchmark::DoNotOptimize(rect);
+        }
+    }
+
+    void BM_MergeHorizontally(benchmark::State &state) {
+        const Rectangle lower(4, 5, {3, 7});
+        const Rectangle upper(4, 1, {3, 12});
+        for (auto _:state) {
+            benchmark::DoNotOptimize(merge_horizontally(lower, upper));
+        }
+    }
+
+    void BM_MergeVertically(benchmark::State &state) {
+        const Rectangle left(4, 5);
+        const Rectangle right(1, 5, {4, 0});
+        for (auto _:state) {
+            benchmark::DoNotOptimize(merge_vertically(left, right));
+        }
+    }
+
+    // The loop Rectangles::operator+= used before the bulk kernel.
+    void BM_TranslateElementwise(benchmark::State &state) {
+        std::vector<Rectangle> rects = make_layer(state.range(0));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            for (Rectangle &rect:rects) {
+                rect += vec;
+            }
+            benchmark::DoNotOptimize(rects.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Rectangle));
+    }
+
+    void BM_TranslateRectangles(benchmark::State &state) {
+        Rectangles rects(make_layer(state.range(0)));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            rects += vec;
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Rectangle));
+    }
+
+    void BM_ReflectElementwise(benchmark::State &state) {
+        std::vector<Rectangle> rects = make_layer(state.range(0));
+        for (auto _:state) {
+            for (Rectangle &rect:rects) {
+                rect = rect.reflection();
+            }
+            benchmark::DoNotOptimize(rects.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Rectangle));
+    }
+
+    void BM_ReflectRectangles(benchmark::State &state) {
+        Rectangles rects(make_layer(state.range(0)));
+        for (auto _:state) {
+            rects.reflect();
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Rectangle));
+    }
+
+    void BM_TransformChained(benchmark::State &state) {
+        const Rectangles layer(make_layer(state.range(0)));
+        for (auto _:state) {
+            Rectangles view = layer + Vector(3, -2);
+            view.reflect();
+            view += Vector(-1, 5);
+            benchmark::DoNotOptimize(view.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_TransformFused(benchmark::State &state) {
+        const Rectangles layer(make_layer(state.range(0)));
+        constexpr Transform view_transform = Transform::translation(Vector(3, -2))
+                .then(Transform::reflection())
+                .then(Transform::translation(Vector(-1, 5)));
+        for (auto _:state) {
+            Rectangles view = view_transform(layer);
+            benchmark::DoNotOptimize(view.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_ParallelTranslate(benchmark::State &state) {
+        Rectangles rects(make_layer(state.range(0)));
+        ParallelExecutor executor(static_cast<unsigned>(state.range(1)));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            parallel_translate(executor, rects, vec);
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Rectangle));
+    }
+
+    void BM_RectanglesCopyAdd(benchmark::State &state) {
+        const Rectangles rects(make_layer(state.range(0)));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            Rectangles res = rects + vec;
+            benchmark::DoNotOptimize(res);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Three additions collapse into one offset applied in a single pass.
+    void BM_RectanglesChainedAdd(benchmark::State &state) {
+        const Rectangles rects(make_layer(state.range(0)));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            Rectangles res = rects + vec + vec + vec;
+            benchmark::DoNotOptimize(res);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_RectanglesMoveAdd(benchmark::State &state) {
+        Rectangles rects(make_layer(state.range(0)));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            rects = std::move(rects) + vec;
+            benchmark::DoNotOptimize(rects);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // A frame translating a layer three times through copying operator+.
+    // The layer lives on the heap, behind a counting resource.
+    void BM_FrameDefaultAllocator(benchmark::State &state) {
+        CountingResource heap;
+        std::vector<Rectangle> rects = make_layer(state.range(0));
+        const pmr::Rectangles layer(std::pmr::vector<Rectangle>(rects.begin(), rects.end(), &heap));
+        const Vector vec(3, -2);
+        std::size_t before = heap.allocations();
+        for (auto _:state) {
+            pmr::Rectangles frame = layer + vec;
+            pmr::Rectangles shifted = frame + vec;
+            pmr::Rectangles back = shifted + vec;
+            benchmark::DoNotOptimize(back);
+        }
+        state.counters["allocs_per_frame"] = benchmark::Counter(
+                static_cast<double>(heap.allocations() - before) / static_cast<double>(state.iterations()));
+    }
+
+    void BM_FrameArena(benchmark::State &state) {
+        CountingResource heap;
+        std::vector<std::byte> buffer(4 * sizeof(Rectangle) * state.range(0));
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), &heap);
+        std::vector<Rectangle> rects = make_layer(state.range(0));
+        const pmr::Rectangles layer(std::pmr::vector<Rectangle>(rects.begin(), rects.end(), &heap));
+        const Vector vec(3, -2);
+        std::size_t before = heap.allocations();
+        for (auto _:state) {
+            {
+                pmr::Rectangles frame(layer, &arena);
+                frame += vec;
+                pmr::Rectangles shifted = frame + vec;
+                pmr::Rectangles back = shifted + vec;
+                benchmark::DoNotOptimize(back);
+            }
+            arena.release();
+        }
+        state.counters["allocs_per_frame"] = benchmark::Counter(
+                static_cast<double>(heap.allocations() - before) / static_cast<double>(state.iterations()));
+    }
+
+    void BM_FrameTranslateInto(benchmark::State &state) {
+        CountingResource heap;
+        std::vector<Rectangle> rects = make_layer(state.range(0));
+        const pmr::Rectangles layer(std::pmr::vector<Rectangle>(rects.begin(), rects.end(), &heap));
+        const Vector vec(3, -2);
+        pmr::Rectangles frame(&heap);
+        layer.translate_into(frame, vec);
+        std::size_t before = heap.allocations();
+        for (auto _:state) {
+            layer.translate_into(frame, vec);
+            frame += vec;
+            benchmark::DoNotOptimize(frame.data());
+        }
+        state.counters["allocs_per_frame"] = benchmark::Counter(
+                static_cast<double>(heap.allocations() - before) / static_cast<double>(state.iterations()));
+    }
+
+    void BM_RectanglesEqual(benchmark::State &state) {
+        const Rectangles a(make_layer(state.range(0)));
+        const Rectangles b(make_layer(state.range(0)));
+        for (auto _:state) {
+            benchmark::DoNotOptimize(a == b);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_RectanglesHashUnchanged(benchmark::State &state) {
+        HashedRectangles layer(Rectangles(make_layer(state.range(0))));
+        const Vector vec(3, -2);
+        for (auto _:state) {
+            layer += vec;
+            benchmark::DoNotOptimize(layer.hash());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_ClipViewport(benchmark::State &state) {
+        const Rectangles rects(make_layer(state.range(0)));
+        const auto side = static_cast<Vector::coordinate_t>(state.range(0) / 2);
+        const Rectangle viewport(side, side, {side / 2, -side});
+        Rectangles out;
+        for (auto _:state) {
+            rects.clip(viewport, out);
+            benchmark::DoNotOptimize(out);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Rectangles scattered over a square with about two neighbours each.
+    Rectangles make_scattered(std::size_t n) {
+        std::vector<Rectangle> rects;
+        rects.reserve(n);
+        const auto side = static_cast<Vector::coordinate_t>(4 * n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto c = static_cast<Vector::coordinate_t>(i);
+            rects.emplace_back(1 + c % 13, 1 + c % 7, Position((c * 7919) % side, (c * 104729) % 64));
+        }
+        return Rectangles(std::move(rects));
+    }
+
+    void BM_OverlapsNaive(benchmark::State &state) {
+        const Rectangles rects = make_scattered(state.range(0));
+        std::vector<OverlapPair> pairs;
+        for (auto _:state) {
+            pairs.clear();
+            for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+                for (Rectangles::size_t j = i + 1; j < rects.size(); ++j) {
+                    if (intersects(rects[i], rects[j]))
+                        pairs.emplace_back(i, j);
+                }
+            }
+            benchmark::DoNotOptimize(pairs.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_OverlapsSweep(benchmark::State &state) {
+        const Rectangles rects = make_scattered(state.range(0));
+        std::vector<OverlapPair> pairs;
+        ParallelExecutor executor;
+        for (auto _:state) {
+            find_overlaps(executor, rects, pairs);
+            benchmark::DoNotOptimize(pairs.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_CoveredArea(benchmark::State &state) {
+        const Rectangles rects = make_scattered(state.range(0));
+        for (auto _:state) {
+            benchmark::DoNotOptimize(covered_area(rects));
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_DirtyRegionInsert(benchmark::State &state) {
+        const Rectangles rects = make_scattered(state.range(0));
+        for (auto _:state) {
+            DirtyRegion dirty;
+            for (const Rectangle &rect:rects) {
+                dirty.insert(rect);
+            }
+            benchmark::DoNotOptimize(dirty.area());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_MergeAll(benchmark::State &state) {
+        const Rectangles rects(make_row(state.range(0)));
+        for (auto _:state) {
+            benchmark::DoNotOptimize(merge_all(rects));
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_MergeAllParallel(benchmark::State &state) {
+        const Rectangles rects(make_row(state.range(0)));
+        ParallelExecutor executor;
+        for (auto _:state) {
+            benchmark::DoNotOptimize(merge_all_parallel(executor, rects));
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_Area(benchmark::State &state) {
+        const Rectangles rects(make_layer(state.range(0)));
+        for (auto _:state) {
+            Rectangle::area_t sum = 0;
+            for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+                sum += rects[i].area();
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_VectorAdd);
+BENCHMARK(BM_VectorReflection);
+BENCHMARK(BM_PositionAdd);
+BENCHMARK(BM_RectangleAdd);
+BENCHMARK(BM_RectangleReflection);
+BENCHMARK(BM_MergeHorizontally);
+BENCHMARK(BM_MergeVertically);
+
+BENCHMARK(BM_TranslateElementwise)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_TranslateRectangles)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_ReflectElementwise)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_ReflectRectangles)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_ParallelTranslate)->ArgsProduct({{1 << 16, 1 << 20, 1 << 22}, {1, 2, 4}})->UseRealTime();
+BENCHMARK(BM_TransformChained)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_TransformFused)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_RectanglesCopyAdd)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_RectanglesChainedAdd)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_RectanglesMoveAdd)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+
+BENCHMARK(BM_FrameDefaultAllocator)->RangeMultiplier(16)->Range(1 << 4, 1 << 16);
+BENCHMARK(BM_FrameArena)->RangeMultiplier(16)->Range(1 << 4, 1 << 16);
+BENCHMARK(BM_FrameTranslateInto)->RangeMultiplier(16)->Range(1 << 4, 1 << 16);
+
+BENCHMARK(BM_RectanglesEqual)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
+BENCHMARK(BM_RectanglesHashUnchanged)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
+
+BENCHMARK(BM_ClipViewport)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+
+BENCHMARK(BM_OverlapsNaive)->RangeMultiplier(8)->Range(1 << 9, 1 << 15);
+BENCHMARK(BM_OverlapsSweep)->RangeMultiplier(8)->Range(1 << 9, 1 << 20);
+
+BENCHMARK(BM_CoveredArea)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_DirtyRegionInsert)->RangeMultiplier(16)->Range(1 << 6, 1 << 16);
+
+BENCHMARK(BM_MergeAll)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
+BENCHMARK(BM_MergeAllParallel)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
+BENCHMARK(BM_Area)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,229 @@
+#ifndef JNP1_3_HASHED_RECTANGLES_H
+#define JNP1_3_HASHED_RECTANGLES_H
+
+#include "geometry.h"
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+// Rectangles with a content hash kept up to date by every mutation, so
+// hash() is O(1) and unequal collections are usually told apart without
+// reading them. Elements are only handed out as const references; they are
+// changed through set() and the bulk operations, which update the hash.
+template<typename T, typename Allocator = std::allocator<basic_rectangle<T>>>
+class basic_hashed_rectangles {
+public:
+    using size_t = typename basic_rectangles<T, Allocator>::size_t;
+
+    using const_iterator = typename basic_rectangles<T, Allocator>::const_iterator;
+
+    basic_hashed_rectangles() = default;
+
+    basic_hashed_rectangles(std::initializer_list<basic_rectangle<T>> rects, const Allocator &alloc = Allocator());
+
+    explicit basic_hashed_rectangles(basic_rectangles<T, Allocator> rects);
+
+    basic_hashed_rectangles(const basic_hashed_rectangles &other) = default;
+
+    basic_hashed_rectangles &operator=(const basic_hashed_rectangles &other) = default;
+
+    basic_hashed_rectangles(basic_hashed_rectangles &&other) = default;
+
+    basic_hashed_rectangles &operator=(basic_hashed_rectangles &&other) = default;
+
+    const basic_rectangle<T> &operator[](size_t i) const;
+
+    void set(size_t i, const basic_rectangle<T> &rect);
+
+    // Compares the contents, rejecting early on different sizes or hashes.
+    bool operator==(const basic_hashed_rectangles &other) const;
+
+    bool operator!=(const basic_hashed_rectangles &other) const;
+
+    // Same as rectangles().hash(), in O(1).
+    [[nodiscard]] std::size_t hash() const;
+
+    // O(1) on the hash unless T is narrower than 64 bits, in which case it
+    // is recomputed along with the translation.
+    basic_hashed_rectangles &operator+=(const basic_vector<T> &vec);
+
+    // Same as operator+=, with the rectangles translated by
+    // translate(storage), which must add vec to every one of them; used
+    // to run the translation on several threads.
+    template<typename Translate>
+    basic_hashed_rectangles &translate(const basic_vector<T> &vec, Translate &&translate);
+
+    void reflect();
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] bool empty() const;
+
+    void reserve(size_t n);
+
+    void clear();
+
+    void push_back(const basic_rectangle<T> &rect);
+
+    template<typename... Args>
+    const basic_rectangle<T> &emplace_back(Args &&... args);
+
+    [[nodiscard]] const basic_rectangles<T, Allocator> &rectangles() const &;
+
+    [[nodiscard]] basic_rectangles<T, Allocator> rectangles() &&;
+
+    [[nodiscard]] const_iterator begin() const;
+
+    [[nodiscard]] const_iterator end() const;
+
+private:
+    void rehash();
+
+    basic_rectangles<T, Allocator> _rects;
+    detail::rectangles_hash<T> _hash;
+};
+
+
+using HashedRectangles = basic_hashed_rectangles<int_fast32_t>;
+
+
+template<typename T, typename Allocator>
+basic_hashed_rectangles<T, Allocator>::basic_hashed_rectangles(std::initializer_list<basic_rectangle<T>> rects,
+                                                               const Allocator &alloc) : _rects(rects, alloc) {
+    this->rehash();
+}
+
+template<typename T, typename Allocator>
+basic_hashed_rectangles<T, Allocator>::basic_hashed_rectangles(basic_rectangles<T, Allocator> rects)
+        : _rects(std::move(rects)) {
+    this->rehash();
+}
+
+template<typename T, typename Allocator>
+void basic_hashed_rectangles<T, Allocator>::rehash() {
+    this->_hash.reset();
+    for (const basic_rectangle<T> &rect:this->_rects)
+        this->_hash.append(rect);
+}
+
+template<typename T, typename Allocator>
+const basic_rectangle<T> &basic_hashed_rectangles<T, Allocator>::operator[](size_t i) const {
+    return this->_rects[i];
+}
+
+template<typename T, typename Allocator>
+void basic_hashed_rectangles<T, Allocator>::set(size_t i, const basic_rectangle<T> &rect) {
+    basic_rectangle<T> &stored = this->_rects[i];
+    this->_hash.replace(i, stored, rect);
+    stored = rect;
+}
+
+template<typename T, typename Allocator>
+bool basic_hashed_rectangles<T, Allocator>::operator==(const basic_hashed_rectangles &other) const {
+    return this->size() == other.size() && this->hash() == other.hash() && this->_rects == other._rects;
+}
+
+template<typename T, typename Allocator>
+bool basic_hashed_rectangles<T, Allocator>::operator!=(const basic_hashed_rectangles &other) const {
+    return !(*this == other);
+}
+
+template<typename T, typename Allocator>
+std::size_t basic_hashed_rectangles<T, Allocator>::hash() const {
+    return this->_hash.value();
+}
+
+template<typename T, typename Allocator>
+basic_hashed_rectangles<T, Allocator> &basic_hashed_rectangles<T, Allocator>::operator+=(const basic_vector<T> &vec) {
+    return this->translate(vec, [&](basic_rectangles<T, Allocator> &storage) {
+        storage += vec;
+    });
+}
+
+template<typename T, typename Allocator>
+template<typename Translate>
+basic_hashed_rectangles<T, Allocator> &
+basic_hashed_rectangles<T, Allocator>::translate(const basic_vector<T> &vec, Translate &&translate) {
+    translate(this->_rects);
+    if constexpr (detail::rectangles_hash<T>::linear) {
+        this->_hash.translate(vec);
+    } else {
+        this->rehash();
+    }
+    return *this;
+}
+
+template<typename T, typename Allocator>
+void basic_hashed_rectangles<T, Allocator>::reflect() {
+    this->_rects.reflect();
+    this->rehash();
+}
+
+template<typename T, typename Allocator>
+typename basic_hashed_rectangles<T, Allocator>::size_t basic_hashed_rectangles<T, Allocator>::size() const {
+    return this->_rects.size();
+}
+
+template<typename T, typename Allocator>
+bool basic_hashed_rectangles<T, Allocator>::empty() const {
+    return this->_rects.empty();
+}
+
+template<typename T, typename Allocator>
+void basic_hashed_rectangles<T, Allocator>::reserve(size_t n) {
+    this->_rects.reserve(n);
+}
+
+template<typename T, typename Allocator>
+void basic_hashed_rectangles<T, Allocator>::clear() {
+    this->_rects.clear();
+    this->_hash.reset();
+}
+
+template<typename T, typename Allocator>
+void basic_hashed_rectangles<T, Allocator>::push_back(const basic_rectangle<T> &rect) {
+    this->_rects.push_back(rect);
+    this->_hash.append(rect);
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+const basic_rectangle<T> &basic_hashed_rectangles<T, Allocator>::emplace_back(Args &&... args) {
+    const basic_rectangle<T> &rect = this->_rects.emplace_back(std::forward<Args>(args)...);
+    this->_hash.append(rect);
+    return rect;
+}
+
+template<typename T, typename Allocator>
+const basic_rectangles<T, Allocator> &basic_hashed_rectangles<T, Allocator>::rectangles() const &{
+    return this->_rects;
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> basic_hashed_rectangles<T, Allocator>::rectangles() &&{
+    this->_hash.reset();
+    return std::move(this->_rects);
+}
+
+template<typename T, typename Allocator>
+typename basic_hashed_rectangles<T, Allocator>::const_iterator basic_hashed_rectangles<T, Allocator>::begin() const {
+    return this->_rects.begin();
+}
+
+template<typename T, typename Allocator>
+typename basic_hashed_rectangles<T, Allocator>::const_iterator basic_hashed_rectangles<T, Allocator>::end() const {
+    return this->_rects.end();
+}
+
+
+namespace std {
+    template<typename T, typename Allocator>
+    struct hash<basic_hashed_rectangles<T, Allocator>> {
+        std::size_t operator()(const basic_hashed_rectangles<T, Allocator> &rects) const {
+            return rects.hash();
+        }
+    };
+}
+
+#endif //JNP1_3_HASHED_RECTANGLES_H
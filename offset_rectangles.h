@@ -0,0 +1,240 @@
+#ifndef JNP1_3_OFFSET_RECTANGLES_H
+#define JNP1_3_OFFSET_RECTANGLES_H
+
+#include "geometry.h"
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+// Rectangles with a pending translation. operator+= only updates the
+// offset, which is added to elements as they are read and folded into the
+// storage by flush().
+template<typename T, typename Allocator = std::allocator<basic_rectangle<T>>>
+class basic_offset_rectangles {
+public:
+    using size_t = typename basic_rectangles<T, Allocator>::size_t;
+
+    // Yields the translated rectangles by value.
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = basic_rectangle<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = basic_rectangle<T>;
+
+        basic_rectangle<T> operator*() const;
+
+        const_iterator &operator++();
+
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator &other) const;
+
+        bool operator!=(const const_iterator &other) const;
+
+    private:
+        friend class basic_offset_rectangles;
+
+        const_iterator(const basic_offset_rectangles *owner, size_t i);
+
+        const basic_offset_rectangles *_owner;
+        size_t _i;
+    };
+
+    basic_offset_rectangles() = default;
+
+    basic_offset_rectangles(std::initializer_list<basic_rectangle<T>> rects, const Allocator &alloc = Allocator());
+
+    explicit basic_offset_rectangles(basic_rectangles<T, Allocator> rects);
+
+    basic_offset_rectangles(const basic_offset_rectangles &other) = default;
+
+    basic_offset_rectangles &operator=(const basic_offset_rectangles &other) = default;
+
+    basic_offset_rectangles(basic_offset_rectangles &&other) = default;
+
+    basic_offset_rectangles &operator=(basic_offset_rectangles &&other) = default;
+
+    basic_rectangle<T> operator[](size_t i) const;
+
+    // Stores rect so that operator[](i) returns it under the current offset.
+    void set(size_t i, const basic_rectangle<T> &rect);
+
+    bool operator==(const basic_offset_rectangles &other) const;
+
+    basic_offset_rectangles &operator+=(const basic_vector<T> &vec);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] const basic_vector<T> &offset() const;
+
+    // The stored rectangles, without the pending offset.
+    [[nodiscard]] const basic_rectangles<T, Allocator> &storage() const;
+
+    // Applies the pending offset to the storage in a single pass.
+    void flush();
+
+    [[nodiscard]] basic_rectangles<T, Allocator> rectangles() const &;
+
+    [[nodiscard]] basic_rectangles<T, Allocator> rectangles() &&;
+
+    [[nodiscard]] const_iterator begin() const;
+
+    [[nodiscard]] const_iterator end() const;
+
+private:
+    basic_rectangles<T, Allocator> _rects;
+    basic_vector<T> _offset{0, 0};
+};
+
+
+using OffsetRectangles = basic_offset_rectangles<int_fast32_t>;
+
+
+template<typename T, typename Allocator>
+basic_rectangle<T> merge_all(const basic_offset_rectangles<T, Allocator> &rectangles);
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator> operator+(basic_offset_rectangles<T, Allocator> rects,
+                                                const basic_vector<T> &vec);
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator> operator+(const basic_vector<T> &vec,
+                                                basic_offset_rectangles<T, Allocator> rects);
+
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator>::const_iterator::const_iterator(const basic_offset_rectangles *owner, size_t i)
+        : _owner(owner), _i(i) {}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> basic_offset_rectangles<T, Allocator>::const_iterator::operator*() const {
+    return (*this->_owner)[this->_i];
+}
+
+template<typename T, typename Allocator>
+typename basic_offset_rectangles<T, Allocator>::const_iterator &
+basic_offset_rectangles<T, Allocator>::const_iterator::operator++() {
+    ++this->_i;
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename basic_offset_rectangles<T, Allocator>::const_iterator
+basic_offset_rectangles<T, Allocator>::const_iterator::operator++(int) {
+    const_iterator res(*this);
+    ++this->_i;
+    return res;
+}
+
+template<typename T, typename Allocator>
+bool basic_offset_rectangles<T, Allocator>::const_iterator::operator==(const const_iterator &other) const {
+    return this->_owner == other._owner && this->_i == other._i;
+}
+
+template<typename T, typename Allocator>
+bool basic_offset_rectangles<T, Allocator>::const_iterator::operator!=(const const_iterator &other) const {
+    return !(*this == other);
+}
+
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator>::basic_offset_rectangles(std::initializer_list<basic_rectangle<T>> rects,
+                                                               const Allocator &alloc) : _rects(rects, alloc) {}
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator>::basic_offset_rectangles(basic_rectangles<T, Allocator> rects)
+        : _rects(std::move(rects)) {}
+
+template<typename T, typename Allocator>
+basic_rectangle<T> basic_offset_rectangles<T, Allocator>::operator[](size_t i) const {
+    return this->_rects[i] + this->_offset;
+}
+
+template<typename T, typename Allocator>
+void basic_offset_rectangles<T, Allocator>::set(size_t i, const basic_rectangle<T> &rect) {
+    this->_rects[i] = rect + basic_vector<T>(-this->_offset.x(), -this->_offset.y());
+}
+
+template<typename T, typename Allocator>
+bool basic_offset_rectangles<T, Allocator>::operator==(const basic_offset_rectangles &other) const {
+    if (this->size() != other.size())
+        return false;
+    for (size_t i = 0; i < this->size(); ++i) {
+        if (!((*this)[i] == other[i]))
+            return false;
+    }
+    return true;
+}
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator> &basic_offset_rectangles<T, Allocator>::operator+=(const basic_vector<T> &vec) {
+    this->_offset += vec;
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename basic_offset_rectangles<T, Allocator>::size_t basic_offset_rectangles<T, Allocator>::size() const {
+    return this->_rects.size();
+}
+
+template<typename T, typename Allocator>
+const basic_vector<T> &basic_offset_rectangles<T, Allocator>::offset() const {
+    return this->_offset;
+}
+
+template<typename T, typename Allocator>
+const basic_rectangles<T, Allocator> &basic_offset_rectangles<T, Allocator>::storage() const {
+    return this->_rects;
+}
+
+template<typename T, typename Allocator>
+void basic_offset_rectangles<T, Allocator>::flush() {
+    if (this->_offset == basic_vector<T>(0, 0))
+        return;
+    this->_rects += this->_offset;
+    this->_offset = basic_vector<T>(0, 0);
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> basic_offset_rectangles<T, Allocator>::rectangles() const &{
+    return this->_rects + this->_offset;
+}
+
+template<typename T, typename Allocator>
+basic_rectangles<T, Allocator> basic_offset_rectangles<T, Allocator>::rectangles() &&{
+    this->flush();
+    return std::move(this->_rects);
+}
+
+template<typename T, typename Allocator>
+typename basic_offset_rectangles<T, Allocator>::const_iterator basic_offset_rectangles<T, Allocator>::begin() const {
+    return const_iterator(this, 0);
+}
+
+template<typename T, typename Allocator>
+typename basic_offset_rectangles<T, Allocator>::const_iterator basic_offset_rectangles<T, Allocator>::end() const {
+    return const_iterator(this, this->size());
+}
+
+
+template<typename T, typename Allocator>
+basic_rectangle<T> merge_all(const basic_offset_rectangles<T, Allocator> &rectangles) {
+    return merge_all(rectangles.storage()) + rectangles.offset();
+}
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator> operator+(basic_offset_rectangles<T, Allocator> rects,
+                                                const basic_vector<T> &vec) {
+    return std::move(rects += vec);
+}
+
+template<typename T, typename Allocator>
+basic_offset_rectangles<T, Allocator> operator+(const basic_vector<T> &vec,
+                                                basic_offset_rectangles<T, Allocator> rects) {
+    return std::move(rects += vec);
+}
+
+#endif //JNP1_3_OFFSET_RECTANGLES_H
@@ -0,0 +1,214 @@
+#include "parallel.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // The merge_all loop over rectangles[first, last) starting from rect,
+    // reporting failure instead of asserting.
+    std::optional<Rectangle> fold_checked(const Rectangles &rectangles, Rectangles::size_t first,
+                                          Rectangles::size_t last, Rectangle rect) {
+        for (Rectangles::size_t i = first; i < last; ++i) {
+            const Rectangle &curr = rectangles.unchecked(i);
+            if (can_be_merged_horizontally(rect, curr)) {
+                rect = detail::merge_horizontally_helper(rect, curr);
+            } else if (can_be_merged_vertically(rect, curr)) {
+                rect = detail::merge_vertically_helper(rect, curr);
+            } else {
+                return std::nullopt;
+            }
+        }
+        return rect;
+    }
+}
+
+ParallelExecutor::ParallelExecutor(unsigned threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    this->_blocks = std::make_unique<Block[]>(threads);
+    this->_workers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        this->_workers.emplace_back(&ParallelExecutor::worker_loop, this, i);
+    }
+}
+
+ParallelExecutor::~ParallelExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stop = true;
+    }
+    this->_wake.notify_all();
+    for (std::thread &worker:this->_workers) {
+        worker.join();
+    }
+}
+
+unsigned ParallelExecutor::concurrency() const {
+    return static_cast<unsigned>(this->_workers.size()) + 1;
+}
+
+void ParallelExecutor::run(std::size_t count, std::size_t grain, chunk_fn fn, void *job) {
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    if (chunks <= 1 || this->_workers.empty()) {
+        for (std::size_t first = 0; first < count; first += grain) {
+            fn(job, first, std::min(count, first + grain));
+        }
+        return;
+    }
+
+    const unsigned threads = this->concurrency();
+    for (unsigned t = 0; t < threads; ++t) {
+        this->_blocks[t].next.store(chunks * t / threads, std::memory_order_relaxed);
+        this->_blocks[t].end = chunks * (t + 1) / threads;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_fn = fn;
+        this->_job = job;
+        this->_count = count;
+        this->_grain = grain;
+        this->_busy = static_cast<unsigned>(this->_workers.size());
+        ++this->_generation;
+    }
+    this->_wake.notify_all();
+    this->work(0);
+
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    this->_done.wait(lock, [this] { return this->_busy == 0; });
+}
+
+void ParallelExecutor::work(unsigned self) {
+    const unsigned threads = this->concurrency();
+    for (unsigned i = 0; i < threads; ++i) {
+        Block &block = this->_blocks[(self + i) % threads];
+        for (std::size_t c = block.next.fetch_add(1, std::memory_order_relaxed); c < block.end;
+             c = block.next.fetch_add(1, std::memory_order_relaxed)) {
+            const std::size_t first = c * this->_grain;
+            this->_fn(this->_job, first, std::min(this->_count, first + this->_grain));
+        }
+    }
+}
+
+void ParallelExecutor::worker_loop(unsigned self) {
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_wake.wait(lock, [&] { return this->_stop || this->_generation != seen; });
+            if (this->_stop)
+                return;
+            seen = this->_generation;
+        }
+        this->work(self);
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if (--this->_busy == 0)
+                this->_done.notify_one();
+        }
+    }
+}
+
+void parallel_translate(ParallelExecutor &executor, Rectangles &rects, const Vector &vec, std::size_t grain) {
+    Rectangle *data = rects.data();
+    executor.for_chunks(rects.size(), grain, [&](std::size_t first, std::size_t last) {
+        detail::translate_all(data + first, last - first, vec);
+    });
+}
+
+void parallel_translate(ParallelExecutor &executor, HashedRectangles &rects, const Vector &vec, std::size_t grain) {
+    rects.translate(vec, [&](Rectangles &storage) {
+        parallel_translate(executor, storage, vec, grain);
+    });
+}
+
+void parallel_reflect(ParallelExecutor &executor, Rectangles &rects, std::size_t grain) {
+    Rectangle *data = rects.data();
+    executor.for_chunks(rects.size(), grain, [&](std::size_t first, std::size_t last) {
+        detail::reflect_all(data + first, last - first);
+    });
+}
+
+wide_area_t parallel_total_area(ParallelExecutor &executor, const Rectangles &rects, std::size_t grain) {
+    grain = std::max<std::size_t>(grain, 1);
+    std::vector<wide_area_t> partial((rects.size() + grain - 1) / grain, 0);
+    executor.for_chunks(rects.size(), grain, [&](std::size_t first, std::size_t last) {
+        wide_area_t sum = 0;
+        for (std::size_t i = first; i < last; ++i) {
+            sum += wide_area(rects.unchecked(i));
+        }
+        partial[first / grain] = sum;
+    });
+    return std::accumulate(partial.begin(), partial.end(), wide_area_t(0));
+}
+
+void parallel_cull(ParallelExecutor &executor, const Rectangles &rects, const Rectangle &viewport, Rectangles &out,
+                   std::size_t grain) {
+    // Counts the survivors of every chunk first, so that the second pass
+    // knows where each chunk writes and the order is kept.
+    grain = std::max<std::size_t>(grain, 1);
+    std::vector<std::size_t> offsets((rects.size() + grain - 1) / grain + 1, 0);
+    executor.for_chunks(rects.size(), grain, [&](std::size_t first, std::size_t last) {
+        std::size_t kept = 0;
+        for (std::size_t i = first; i < last; ++i) {
+            kept += intersects(rects.unchecked(i), viewport);
+        }
+        offsets[first / grain + 1] = kept;
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    // In place, a chunk could overwrite rectangles an earlier chunk has not
+    // read yet, so the survivors are gathered in scratch storage first.
+    Rectangles scratch(rects.get_allocator());
+    Rectangles &target = &out == &rects ? scratch : out;
+    target.resize(offsets.back(), viewport);
+    Rectangle *data = target.data();
+    executor.for_chunks(rects.size(), grain, [&](std::size_t first, std::size_t last) {
+        Rectangle *dest = data + offsets[first / grain];
+        for (std::size_t i = first; i < last; ++i) {
+            const Rectangle &rect = rects.unchecked(i);
+            if (intersects(rect, viewport))
+                *dest++ = rect;
+        }
+    });
+    if (&target != &out)
+        out = std::move(scratch);
+}
+
+std::optional<Rectangle> merge_all_parallel(ParallelExecutor &executor, const Rectangles &rectangles,
+                                            std::size_t grain) {
+    const Rectangles::size_t n = rectangles.size();
+    if (n == 0)
+        return std::nullopt;
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (n + grain - 1) / grain;
+
+    // While the fold succeeds its accumulated rectangle is the bounding box
+    // of the prefix, so each chunk can start from the box of the previous
+    // chunks instead of waiting for their fold.
+    std::vector<std::optional<Rectangle>> boxes(chunks);
+    executor.for_chunks(n, grain, [&](std::size_t first, std::size_t last) {
+        Rectangle box = rectangles.unchecked(first);
+        for (Rectangles::size_t i = first + 1; i < last; ++i) {
+            box = bounding_union(box, rectangles.unchecked(i));
+        }
+        boxes[first / grain] = box;
+    });
+
+    std::vector<std::optional<Rectangle>> prefixes(chunks);
+    Rectangle total = *boxes[0];
+    for (std::size_t c = 1; c < chunks; ++c) {
+        prefixes[c] = total;
+        total = bounding_union(total, *boxes[c]);
+    }
+
+    std::vector<char> failed(chunks, false);
+    executor.for_chunks(n, grain, [&](std::size_t first, std::size_t last) {
+        const std::size_t c = first / grain;
+        failed[c] = c == 0 ? !fold_checked(rectangles, first + 1, last, rectangles.unchecked(first))
+                           : !fold_checked(rectangles, first, last, *prefixes[c]);
+    });
+
+    if (std::find(failed.begin(), failed.end(), true) != failed.end())
+        return std::nullopt;
+    return total;
+}
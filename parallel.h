@@ -0,0 +1,106 @@
+#ifndef JNP1_3_PARALLEL_H
+#define JNP1_3_PARALLEL_H
+
+#include "geometry.h"
+#include "hashed_rectangles.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+constexpr std::size_t default_parallel_grain = 1 << 16;
+
+// Persistent pool of threads running chunked loops. A call may only be
+// made from one thread at a time.
+class ParallelExecutor {
+public:
+    // threads counts the calling thread too; 0 means one per hardware thread.
+    explicit ParallelExecutor(unsigned threads = 0);
+
+    ParallelExecutor(const ParallelExecutor &other) = delete;
+
+    ParallelExecutor &operator=(const ParallelExecutor &other) = delete;
+
+    ~ParallelExecutor();
+
+    [[nodiscard]] unsigned concurrency() const;
+
+    // Calls job(first, last) for the consecutive chunks [first, last) of
+    // [0, count), grain elements each except possibly the last, and returns
+    // when all of them are done. Every thread starts on its own contiguous
+    // block of chunks and steals from the other blocks once it runs out, so
+    // repeated calls over the same data mostly keep each part, and the
+    // memory it was first touched from, on the same thread. job must not
+    // throw.
+    template<typename Job>
+    void for_chunks(std::size_t count, std::size_t grain, Job &&job);
+
+private:
+    using chunk_fn = void (*)(void *job, std::size_t first, std::size_t last);
+
+    struct alignas(64) Block {
+        std::atomic<std::size_t> next{0};
+        std::size_t end = 0;
+    };
+
+    void run(std::size_t count, std::size_t grain, chunk_fn fn, void *job);
+
+    void work(unsigned self);
+
+    void worker_loop(unsigned self);
+
+    std::vector<std::thread> _workers;
+    std::unique_ptr<Block[]> _blocks;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::uint64_t _generation = 0;
+    unsigned _busy = 0;
+    bool _stop = false;
+    chunk_fn _fn = nullptr;
+    void *_job = nullptr;
+    std::size_t _count = 0;
+    std::size_t _grain = 1;
+};
+
+// Bulk operations split into chunks of grain rectangles. They give the same
+// results as their sequential counterparts.
+void parallel_translate(ParallelExecutor &executor, Rectangles &rects, const Vector &vec,
+                        std::size_t grain = default_parallel_grain);
+
+// Updates the hash in O(1), like operator+=.
+void parallel_translate(ParallelExecutor &executor, HashedRectangles &rects, const Vector &vec,
+                        std::size_t grain = default_parallel_grain);
+
+void parallel_reflect(ParallelExecutor &executor, Rectangles &rects, std::size_t grain = default_parallel_grain);
+
+// Sum of the areas of the rectangles, counting overlaps as many times as
+// they are covered.
+wide_area_t parallel_total_area(ParallelExecutor &executor, const Rectangles &rects,
+                                std::size_t grain = default_parallel_grain);
+
+// Same as rects.cull(viewport, out); out may be rects too.
+void parallel_cull(ParallelExecutor &executor, const Rectangles &rects, const Rectangle &viewport, Rectangles &out,
+                   std::size_t grain = default_parallel_grain);
+
+// Same result as merge_all. Returns std::nullopt where merge_all would fail
+// its assertion.
+std::optional<Rectangle> merge_all_parallel(ParallelExecutor &executor, const Rectangles &rectangles,
+                                            std::size_t grain = default_parallel_grain);
+
+
+template<typename Job>
+void ParallelExecutor::for_chunks(std::size_t count, std::size_t grain, Job &&job) {
+    using job_t = std::remove_reference_t<Job>;
+    this->run(count, grain, [](void *p, std::size_t first, std::size_t last) {
+        (*static_cast<job_t *>(p))(first, last);
+    }, const_cast<void *>(static_cast<const void *>(std::addressof(job))));
+}
+
+#endif //JNP1_3_PARALLEL_H
@@ -0,0 +1,272 @@
+#include "rectangles_io.h"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr unsigned char magic[4] = {'J', 'N', 'P', 'R'};
+    constexpr std::uint16_t format_version = 1;
+    constexpr std::size_t header_size = 16;
+    constexpr std::size_t columns = 4;
+    constexpr std::size_t io_chunk = 4096;
+
+    void store_le(unsigned char *p, std::uint64_t value, std::size_t bytes) {
+        for (std::size_t b = 0; b < bytes; ++b)
+            p[b] = static_cast<unsigned char>(value >> (8 * b));
+    }
+
+    // Compiles to a plain load on little-endian targets.
+    std::uint64_t load_le(const unsigned char *p, std::size_t bytes) {
+        std::uint64_t value = 0;
+        for (std::size_t b = bytes; b-- > 0;)
+            value = value << 8 | p[b];
+        return value;
+    }
+
+    std::int64_t column_value(const Rectangle &rect, std::size_t col) {
+        switch (col) {
+            case 0:
+                return rect.pos().x();
+            case 1:
+                return rect.pos().y();
+            case 2:
+                return rect.width();
+            default:
+                return rect.height();
+        }
+    }
+
+    bool fits(std::int64_t value) {
+        return value >= std::numeric_limits<Vector::coordinate_t>::min()
+               && value <= std::numeric_limits<Vector::coordinate_t>::max();
+    }
+
+    void write_raw(std::ostream &out, const Rectangles &rects) {
+        std::vector<unsigned char> buffer(io_chunk * 8);
+        for (std::size_t col = 0; col < columns; ++col) {
+            for (Rectangles::size_t first = 0; first < rects.size(); first += io_chunk) {
+                const Rectangles::size_t last = std::min<Rectangles::size_t>(rects.size(), first + io_chunk);
+                for (Rectangles::size_t i = first; i < last; ++i)
+                    store_le(buffer.data() + 8 * (i - first), column_value(rects.unchecked(i), col), 8);
+                out.write(reinterpret_cast<const char *>(buffer.data()),
+                          static_cast<std::streamsize>(8 * (last - first)));
+            }
+        }
+    }
+
+    void write_delta_varint(std::ostream &out, const Rectangles &rects) {
+        std::vector<unsigned char> buffer;
+        buffer.reserve(io_chunk * 10);
+        for (std::size_t col = 0; col < columns; ++col) {
+            std::uint64_t prev = 0;
+            for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+                const auto value = static_cast<std::uint64_t>(column_value(rects.unchecked(i), col));
+                const auto delta = static_cast<std::int64_t>(value - prev);
+                std::uint64_t zigzag = static_cast<std::uint64_t>(delta) << 1 ^ static_cast<std::uint64_t>(delta >> 63);
+                prev = value;
+                while (zigzag >= 0x80) {
+                    buffer.push_back(static_cast<unsigned char>(zigzag | 0x80));
+                    zigzag >>= 7;
+                }
+                buffer.push_back(static_cast<unsigned char>(zigzag));
+                if (buffer.size() >= io_chunk * 9) {
+                    out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
+                }
+            }
+        }
+        out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    }
+
+    // Both readers append the columns one after another to values and grow
+    // it only as data arrives, so a corrupt count cannot cause a huge
+    // allocation.
+    bool read_raw(std::istream &in, std::uint64_t count, std::vector<std::int64_t> &values) {
+        std::vector<unsigned char> buffer(io_chunk * 8);
+        for (std::uint64_t left = columns * count; left > 0;) {
+            const std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(left, io_chunk));
+            if (!in.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(8 * n)))
+                return false;
+            for (std::size_t i = 0; i < n; ++i)
+                values.push_back(static_cast<std::int64_t>(load_le(buffer.data() + 8 * i, 8)));
+            left -= n;
+        }
+        return true;
+    }
+
+    bool read_delta_varint(std::istream &in, std::uint64_t count, std::vector<std::int64_t> &values) {
+        std::streambuf &buf = *in.rdbuf();
+        for (std::size_t col = 0; col < columns; ++col) {
+            std::uint64_t prev = 0;
+            for (std::uint64_t i = 0; i < count; ++i) {
+                std::uint64_t zigzag = 0;
+                for (unsigned shift = 0;; shift += 7) {
+                    const auto byte = buf.sbumpc();
+                    // The tenth byte only has room for the top bit of 64.
+                    if (byte == std::streambuf::traits_type::eof() || shift > 63 || (shift == 63 && (byte & 0x7e)))
+                        return false;
+                    zigzag |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                    if (!(byte & 0x80))
+                        break;
+                }
+                prev += zigzag >> 1 ^ (~(zigzag & 1) + 1);
+                values.push_back(static_cast<std::int64_t>(prev));
+            }
+        }
+        return true;
+    }
+}
+
+void write_rectangles(std::ostream &out, const Rectangles &rects, RectanglesEncoding encoding) {
+    unsigned char header[header_size];
+    std::memcpy(header, magic, sizeof(magic));
+    store_le(header + 4, format_version, 2);
+    store_le(header + 6, static_cast<std::uint16_t>(encoding), 2);
+    store_le(header + 8, rects.size(), 8);
+    out.write(reinterpret_cast<const char *>(header), header_size);
+    if (encoding == RectanglesEncoding::delta_varint) {
+        write_delta_varint(out, rects);
+    } else {
+        write_raw(out, rects);
+    }
+}
+
+std::optional<Rectangles> read_rectangles(std::istream &in) {
+    unsigned char header[header_size];
+    if (!in.read(reinterpret_cast<char *>(header), header_size)
+        || std::memcmp(header, magic, sizeof(magic)) != 0
+        || load_le(header + 4, 2) != format_version)
+        return std::nullopt;
+    const std::uint64_t encoding = load_le(header + 6, 2);
+    const std::uint64_t count = load_le(header + 8, 8);
+    if (count > std::numeric_limits<std::uint64_t>::max() / columns)
+        return std::nullopt;
+
+    std::vector<std::int64_t> values;
+    bool ok;
+    if (encoding == static_cast<std::uint16_t>(RectanglesEncoding::raw)) {
+        ok = read_raw(in, count, values);
+    } else if (encoding == static_cast<std::uint16_t>(RectanglesEncoding::delta_varint)) {
+        ok = read_delta_varint(in, count, values);
+    } else {
+        ok = false;
+    }
+    if (!ok)
+        return std::nullopt;
+
+    std::vector<Rectangle> rects;
+    rects.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::int64_t x = values[i], y = values[count + i];
+        const std::int64_t width = values[2 * count + i], height = values[3 * count + i];
+        if (!fits(x) || !fits(y) || !fits(width) || !fits(height) || width <= 0 || height <= 0)
+            return std::nullopt;
+        rects.emplace_back(width, height, Position(x, y));
+    }
+    return Rectangles(std::move(rects));
+}
+
+MappedRectangles::const_iterator::const_iterator(const MappedRectangles *owner, MappedRectangles::size_t i)
+        : _owner(owner), _i(i) {}
+
+Rectangle MappedRectangles::const_iterator::operator*() const {
+    return (*this->_owner)[this->_i];
+}
+
+MappedRectangles::const_iterator &MappedRectangles::const_iterator::operator++() {
+    ++this->_i;
+    return *this;
+}
+
+MappedRectangles::const_iterator MappedRectangles::const_iterator::operator++(int) {
+    const_iterator old = *this;
+    ++this->_i;
+    return old;
+}
+
+bool MappedRectangles::const_iterator::operator==(const MappedRectangles::const_iterator &other) const {
+    return this->_owner == other._owner && this->_i == other._i;
+}
+
+bool MappedRectangles::const_iterator::operator!=(const MappedRectangles::const_iterator &other) const {
+    return !(*this == other);
+}
+
+std::optional<MappedRectangles> MappedRectangles::open(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_size) < header_size) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    const auto length = static_cast<std::size_t>(st.st_size);
+    void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return std::nullopt;
+
+    const auto *data = static_cast<const unsigned char *>(mapping);
+    const std::uint64_t count = load_le(data + 8, 8);
+    if (std::memcmp(data, magic, sizeof(magic)) != 0
+        || load_le(data + 4, 2) != format_version
+        || load_le(data + 6, 2) != static_cast<std::uint16_t>(RectanglesEncoding::raw)
+        || count > (length - header_size) / (8 * columns)) {
+        ::munmap(mapping, length);
+        return std::nullopt;
+    }
+    return MappedRectangles(data, length, count);
+}
+
+MappedRectangles::MappedRectangles(const unsigned char *data, std::size_t length, MappedRectangles::size_t count)
+        : _data(data), _length(length), _count(count) {}
+
+MappedRectangles::MappedRectangles(MappedRectangles &&other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _length(std::exchange(other._length, 0)),
+          _count(std::exchange(other._count, 0)) {}
+
+MappedRectangles &MappedRectangles::operator=(MappedRectangles &&other) noexcept {
+    if (this != &other) {
+        if (this->_data)
+            ::munmap(const_cast<unsigned char *>(this->_data), this->_length);
+        this->_data = std::exchange(other._data, nullptr);
+        this->_length = std::exchange(other._length, 0);
+        this->_count = std::exchange(other._count, 0);
+    }
+    return *this;
+}
+
+MappedRectangles::~MappedRectangles() {
+    if (this->_data)
+        ::munmap(const_cast<unsigned char *>(this->_data), this->_length);
+}
+
+Vector::coordinate_t MappedRectangles::column(std::size_t col, MappedRectangles::size_t i) const {
+    const unsigned char *p = this->_data + header_size + 8 * (col * this->_count + i);
+    return static_cast<Vector::coordinate_t>(static_cast<std::int64_t>(load_le(p, 8)));
+}
+
+Rectangle MappedRectangles::operator[](MappedRectangles::size_t i) const {
+    if (i >= this->_count)
+        throw std::out_of_range("MappedRectangles::operator[]");
+    return Rectangle(this->column(2, i), this->column(3, i), Position(this->column(0, i), this->column(1, i)));
+}
+
+MappedRectangles::size_t MappedRectangles::size() const {
+    return this->_count;
+}
+
+MappedRectangles::const_iterator MappedRectangles::begin() const {
+    return const_iterator(this, 0);
+}
+
+MappedRectangles::const_iterator MappedRectangles::end() const {
+    return const_iterator(this, this->_count);
+}
@@ -0,0 +1,97 @@
+#ifndef JNP1_3_RECTANGLES_IO_H
+#define JNP1_3_RECTANGLES_IO_H
+
+#include "geometry.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <string>
+
+// Binary format, version 1: a 16-byte header ("JNPR", u16 version,
+// u16 encoding, u64 count) followed by the columns x, y, width and height,
+// all little-endian. The raw encoding stores every column as count int64
+// values, which is what MappedRectangles reads in place. The delta_varint
+// encoding stores the difference to the previous value of the same column,
+// zigzag and LEB128 encoded, and can only be loaded with read_rectangles.
+enum class RectanglesEncoding : std::uint16_t {
+    raw = 0,
+    delta_varint = 1,
+};
+
+// Writes rects to out. Failures are reported through the stream state.
+void write_rectangles(std::ostream &out, const Rectangles &rects,
+                      RectanglesEncoding encoding = RectanglesEncoding::raw);
+
+// Reads rectangles written by write_rectangles, std::nullopt if the data is
+// truncated, malformed or of an unknown version.
+std::optional<Rectangles> read_rectangles(std::istream &in);
+
+// Read-only view of a raw-encoded file mapped into memory. Rectangles are
+// decoded on access, so opening costs the same for any number of them.
+// The contents are trusted: only the header and the file size are checked.
+class MappedRectangles {
+public:
+    using size_t = Rectangles::size_t;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Rectangle;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Rectangle;
+
+        Rectangle operator*() const;
+
+        const_iterator &operator++();
+
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator &other) const;
+
+        bool operator!=(const const_iterator &other) const;
+
+    private:
+        friend class MappedRectangles;
+
+        const_iterator(const MappedRectangles *owner, size_t i);
+
+        const MappedRectangles *_owner;
+        size_t _i;
+    };
+
+    // std::nullopt if the file cannot be mapped or is not a raw version 1 file.
+    static std::optional<MappedRectangles> open(const std::string &path);
+
+    MappedRectangles(const MappedRectangles &other) = delete;
+
+    MappedRectangles &operator=(const MappedRectangles &other) = delete;
+
+    MappedRectangles(MappedRectangles &&other) noexcept;
+
+    MappedRectangles &operator=(MappedRectangles &&other) noexcept;
+
+    ~MappedRectangles();
+
+    Rectangle operator[](size_t i) const;
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] const_iterator begin() const;
+
+    [[nodiscard]] const_iterator end() const;
+
+private:
+    MappedRectangles(const unsigned char *data, std::size_t length, size_t count);
+
+    [[nodiscard]] Vector::coordinate_t column(std::size_t col, size_t i) const;
+
+    const unsigned char *_data;
+    std::size_t _length;
+    size_t _count;
+};
+
+#endif //JNP1_3_RECTANGLES_IO_H
@@ -0,0 +1,136 @@
+#include "rectangles_soa.h"
+#include <stdexcept>
+#include <utility>
+
+RectanglesSoA::reference::reference(RectanglesSoA &owner, RectanglesSoA::size_t i) : _owner(owner), _i(i) {}
+
+RectanglesSoA::reference &RectanglesSoA::reference::operator=(const RectanglesSoA::reference &other) {
+    return *this = static_cast<Rectangle>(other);
+}
+
+RectanglesSoA::reference &RectanglesSoA::reference::operator=(const Rectangle &rect) {
+    this->_owner._x[this->_i] = rect.pos().x();
+    this->_owner._y[this->_i] = rect.pos().y();
+    this->_owner._width[this->_i] = rect.width();
+    this->_owner._height[this->_i] = rect.height();
+    return *this;
+}
+
+RectanglesSoA::reference::operator Rectangle() const {
+    return Rectangle(this->width(), this->height(), this->pos());
+}
+
+bool RectanglesSoA::reference::operator==(const Rectangle &rect) const {
+    return static_cast<Rectangle>(*this) == rect;
+}
+
+Position RectanglesSoA::reference::pos() const {
+    return Position(this->_owner._x[this->_i], this->_owner._y[this->_i]);
+}
+
+Rectangle::dimension_t RectanglesSoA::reference::width() const {
+    return this->_owner._width[this->_i];
+}
+
+Rectangle::dimension_t RectanglesSoA::reference::height() const {
+    return this->_owner._height[this->_i];
+}
+
+Rectangle RectanglesSoA::reference::reflection() const {
+    return static_cast<Rectangle>(*this).reflection();
+}
+
+RectanglesSoA::reference &RectanglesSoA::reference::operator+=(const Vector &vec) {
+    this->_owner._x[this->_i] += vec.x();
+    this->_owner._y[this->_i] += vec.y();
+    return *this;
+}
+
+Rectangle::area_t RectanglesSoA::reference::area() const {
+    return static_cast<Rectangle>(*this).area();
+}
+
+
+RectanglesSoA::RectanglesSoA(std::initializer_list<Rectangle> rects) {
+    for (const Rectangle &rect:rects) {
+        this->push_back(rect);
+    }
+}
+
+RectanglesSoA::RectanglesSoA(const Rectangles &rects) {
+    for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+        this->push_back(rects[i]);
+    }
+}
+
+void RectanglesSoA::check_index(RectanglesSoA::size_t i) const {
+    if (i >= this->size())
+        throw std::out_of_range("RectanglesSoA: index out of range");
+}
+
+RectanglesSoA::reference RectanglesSoA::operator[](RectanglesSoA::size_t i) {
+    this->check_index(i);
+    return reference(*this, i);
+}
+
+Rectangle RectanglesSoA::operator[](RectanglesSoA::size_t i) const {
+    this->check_index(i);
+    return Rectangle(this->_width[i], this->_height[i], Position(this->_x[i], this->_y[i]));
+}
+
+bool RectanglesSoA::operator==(const RectanglesSoA &other) const {
+    return this->_x == other._x
+           && this->_y == other._y
+           && this->_width == other._width
+           && this->_height == other._height;
+}
+
+RectanglesSoA &RectanglesSoA::operator+=(const Vector &vec) {
+    // Two independent dense loops, trivially vectorized by the compiler.
+    const Vector::coordinate_t dx = vec.x();
+    const Vector::coordinate_t dy = vec.y();
+    for (Vector::coordinate_t &x:this->_x) {
+        x += dx;
+    }
+    for (Vector::coordinate_t &y:this->_y) {
+        y += dy;
+    }
+    return *this;
+}
+
+void RectanglesSoA::reflect() {
+    this->_x.swap(this->_y);
+    this->_width.swap(this->_height);
+}
+
+RectanglesSoA::size_t RectanglesSoA::size() const {
+    return this->_x.size();
+}
+
+void RectanglesSoA::push_back(const Rectangle &rect) {
+    this->_x.push_back(rect.pos().x());
+    this->_y.push_back(rect.pos().y());
+    this->_width.push_back(rect.width());
+    this->_height.push_back(rect.height());
+}
+
+
+RectanglesSoA operator+(const RectanglesSoA &rects, const Vector &vec) {
+    RectanglesSoA res(rects);
+    res += vec;
+    return res;
+}
+
+RectanglesSoA operator+(const Vector &vec, const RectanglesSoA &rects) {
+    return rects + vec;
+}
+
+RectanglesSoA operator+(RectanglesSoA &&rects, const Vector &vec) {
+    RectanglesSoA res(std::move(rects));
+    res += vec;
+    return res;
+}
+
+RectanglesSoA operator+(const Vector &vec, RectanglesSoA &&rects) {
+    return std::move(rects) + vec;
+}
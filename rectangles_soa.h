@@ -0,0 +1,95 @@
+#ifndef JNP1_3_RECTANGLES_SOA_H
+#define JNP1_3_RECTANGLES_SOA_H
+
+#include "geometry.h"
+#include <initializer_list>
+#include <vector>
+
+// Rectangles stored as four contiguous columns (x, y, width, height)
+// instead of an array of Rectangle objects. Element access goes through
+// a proxy reference, so the interface mirrors the one of Rectangles.
+class RectanglesSoA {
+public:
+    using size_t = std::vector<Vector::coordinate_t>::size_type;
+
+    class reference {
+    public:
+        reference(const reference &other) = default;
+
+        reference &operator=(const reference &other);
+
+        reference &operator=(const Rectangle &rect);
+
+        operator Rectangle() const;
+
+        bool operator==(const Rectangle &rect) const;
+
+        [[nodiscard]] Position pos() const;
+
+        [[nodiscard]] Rectangle::dimension_t width() const;
+
+        [[nodiscard]] Rectangle::dimension_t height() const;
+
+        [[nodiscard]] Rectangle reflection() const;
+
+        reference &operator+=(const Vector &vec);
+
+        [[nodiscard]] Rectangle::area_t area() const;
+
+    private:
+        friend class RectanglesSoA;
+
+        reference(RectanglesSoA &owner, size_t i);
+
+        RectanglesSoA &_owner;
+        size_t _i;
+    };
+
+    RectanglesSoA() = default;
+
+    RectanglesSoA(std::initializer_list<Rectangle> rects);
+
+    explicit RectanglesSoA(const Rectangles &rects);
+
+    RectanglesSoA(const RectanglesSoA &other) = default;
+
+    RectanglesSoA &operator=(const RectanglesSoA &other) = default;
+
+    RectanglesSoA(RectanglesSoA &&other) = default;
+
+    RectanglesSoA &operator=(RectanglesSoA &&other) = default;
+
+    reference operator[](size_t i);
+
+    Rectangle operator[](size_t i) const;
+
+    bool operator==(const RectanglesSoA &other) const;
+
+    RectanglesSoA &operator+=(const Vector &vec);
+
+    // Replaces every rectangle with its reflection. Only swaps the columns.
+    void reflect();
+
+    [[nodiscard]] size_t size() const;
+
+    void push_back(const Rectangle &rect);
+
+private:
+    void check_index(size_t i) const;
+
+    std::vector<Vector::coordinate_t> _x;
+    std::vector<Vector::coordinate_t> _y;
+    std::vector<Rectangle::dimension_t> _width;
+    std::vector<Rectangle::dimension_t> _height;
+};
+
+
+RectanglesSoA operator+(RectanglesSoA &&rects, const Vector &vec);
+
+RectanglesSoA operator+(const Vector &vec, RectanglesSoA &&rects);
+
+RectanglesSoA operator+(const RectanglesSoA &rects, const Vector &vec);
+
+RectanglesSoA operator+(const Vector &vec, const RectanglesSoA &rects);
+
+#endif //JNP1_3_RECTANGLES_SOA_H
@@ -0,0 +1,358 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+namespace {
+    constexpr std::size_t max_entries = 16;
+}
+
+SpatialIndex::Box SpatialIndex::box_of(const Rectangle &rect) {
+    return Box{rect.pos().x(), rect.pos().y(), rect.pos().x() + rect.width(), rect.pos().y() + rect.height()};
+}
+
+bool SpatialIndex::overlaps(const SpatialIndex::Box &a, const SpatialIndex::Box &b) {
+    return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+bool SpatialIndex::contains(const SpatialIndex::Box &box, const Position &point) {
+    return box.x1 <= point.x() && point.x() < box.x2 && box.y1 <= point.y() && point.y() < box.y2;
+}
+
+void SpatialIndex::extend(SpatialIndex::Box &box, const SpatialIndex::Box &other) {
+    box.x1 = std::min(box.x1, other.x1);
+    box.y1 = std::min(box.y1, other.y1);
+    box.x2 = std::max(box.x2, other.x2);
+    box.y2 = std::max(box.y2, other.y2);
+}
+
+double SpatialIndex::area(const SpatialIndex::Box &box) {
+    return static_cast<double>(box.x2 - box.x1) * static_cast<double>(box.y2 - box.y1);
+}
+
+double SpatialIndex::squared_distance(const SpatialIndex::Box &box, const Position &point) {
+    auto axis = [](Vector::coordinate_t lo, Vector::coordinate_t hi, Vector::coordinate_t p) -> double {
+        if (p < lo)
+            return static_cast<double>(lo - p);
+        if (p >= hi)
+            return static_cast<double>(p - hi) + 1;
+        return 0;
+    };
+    double dx = axis(box.x1, box.x2, point.x());
+    double dy = axis(box.y1, box.y2, point.y());
+    return dx * dx + dy * dy;
+}
+
+const SpatialIndex::Box &SpatialIndex::entry_box(const SpatialIndex::Node &node, std::size_t entry) const {
+    return node.leaf ? this->_boxes[entry] : this->_nodes[entry].box;
+}
+
+void SpatialIndex::recompute_box(std::size_t node) {
+    Node &n = this->_nodes[node];
+    if (n.entries.empty())
+        return;
+    n.box = this->entry_box(n, n.entries.front());
+    for (std::size_t entry:n.entries) {
+        extend(n.box, this->entry_box(n, entry));
+    }
+}
+
+std::size_t SpatialIndex::new_node(bool leaf) {
+    if (!this->_free_nodes.empty()) {
+        std::size_t node = this->_free_nodes.back();
+        this->_free_nodes.pop_back();
+        this->_nodes[node] = Node{leaf, Box{}, {}};
+        return node;
+    }
+    this->_nodes.push_back(Node{leaf, Box{}, {}});
+    return this->_nodes.size() - 1;
+}
+
+std::vector<std::size_t> SpatialIndex::pack(std::vector<std::size_t> entries, bool leaf) {
+    // Sort-Tile-Recursive: cut into vertical slices by x, then fill nodes
+    // along y inside every slice.
+    auto box = [&](std::size_t entry) -> const Box & {
+        return leaf ? this->_boxes[entry] : this->_nodes[entry].box;
+    };
+    auto center_x = [&](std::size_t entry) { return box(entry).x1 / 2 + box(entry).x2 / 2; };
+    auto center_y = [&](std::size_t entry) { return box(entry).y1 / 2 + box(entry).y2 / 2; };
+
+    const std::size_t node_count = (entries.size() + max_entries - 1) / max_entries;
+    const auto slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(node_count))));
+    const std::size_t slice_size = slices * max_entries;
+
+    std::sort(entries.begin(), entries.end(), [&](std::size_t a, std::size_t b) {
+        return center_x(a) < center_x(b);
+    });
+
+    std::vector<std::size_t> nodes;
+    for (std::size_t begin = 0; begin < entries.size(); begin += slice_size) {
+        auto first = entries.begin() + static_cast<std::ptrdiff_t>(begin);
+        auto last = entries.begin() + static_cast<std::ptrdiff_t>(std::min(begin + slice_size, entries.size()));
+        std::sort(first, last, [&](std::size_t a, std::size_t b) {
+            return center_y(a) < center_y(b);
+        });
+        for (auto it = first; it < last; it += std::min<std::ptrdiff_t>(max_entries, last - it)) {
+            std::size_t node = this->new_node(leaf);
+            this->_nodes[node].entries.assign(it, it + std::min<std::ptrdiff_t>(max_entries, last - it));
+            this->recompute_box(node);
+            nodes.push_back(node);
+        }
+    }
+    return nodes;
+}
+
+SpatialIndex::SpatialIndex(const Rectangles &rects) {
+    std::vector<std::size_t> level;
+    for (Rectangles::size_t i = 0; i < rects.size(); ++i) {
+        this->_boxes.push_back(box_of(rects[i]));
+        this->_alive.push_back(true);
+        level.push_back(i);
+    }
+    this->_size = rects.size();
+    if (level.empty())
+        return;
+
+    bool leaf = true;
+    do {
+        level = this->pack(std::move(level), leaf);
+        leaf = false;
+    } while (level.size() > 1);
+    this->_root = level.front();
+    this->_empty = false;
+}
+
+std::size_t SpatialIndex::split(std::size_t node) {
+    // Halves the entries along the longer side of the node.
+    Node &n = this->_nodes[node];
+    const bool by_x = n.box.x2 - n.box.x1 >= n.box.y2 - n.box.y1;
+    std::vector<std::size_t> entries = std::move(n.entries);
+    std::sort(entries.begin(), entries.end(), [&](std::size_t a, std::size_t b) {
+        const Box &ba = this->entry_box(this->_nodes[node], a);
+        const Box &bb = this->entry_box(this->_nodes[node], b);
+        return by_x ? ba.x1 / 2 + ba.x2 / 2 < bb.x1 / 2 + bb.x2 / 2
+                    : ba.y1 / 2 + ba.y2 / 2 < bb.y1 / 2 + bb.y2 / 2;
+    });
+
+    const bool leaf = this->_nodes[node].leaf;
+    std::size_t sibling = this->new_node(leaf);
+    auto middle = entries.begin() + static_cast<std::ptrdiff_t>(entries.size() / 2);
+    this->_nodes[sibling].entries.assign(middle, entries.end());
+    entries.erase(middle, entries.end());
+    this->_nodes[node].entries = std::move(entries);
+    this->recompute_box(node);
+    this->recompute_box(sibling);
+    return sibling;
+}
+
+SpatialIndex::id_t SpatialIndex::insert(const Rectangle &rect) {
+    const Box box = box_of(rect);
+    id_t id;
+    if (!this->_free_ids.empty()) {
+        id = this->_free_ids.back();
+        this->_free_ids.pop_back();
+        this->_boxes[id] = box;
+        this->_alive[id] = true;
+    } else {
+        id = this->_boxes.size();
+        this->_boxes.push_back(box);
+        this->_alive.push_back(true);
+    }
+    ++this->_size;
+
+    if (this->_empty) {
+        this->_root = this->new_node(true);
+        this->_nodes[this->_root].entries.push_back(id);
+        this->_nodes[this->_root].box = box;
+        this->_empty = false;
+        return id;
+    }
+
+    // Descend along the least enlargement, remembering the path.
+    std::vector<std::size_t> path{this->_root};
+    while (!this->_nodes[path.back()].leaf) {
+        const Node &n = this->_nodes[path.back()];
+        std::size_t best = n.entries.front();
+        double best_growth = 0, best_area = 0;
+        bool first = true;
+        for (std::size_t child:n.entries) {
+            Box grown = this->_nodes[child].box;
+            extend(grown, box);
+            double child_area = area(this->_nodes[child].box);
+            double growth = area(grown) - child_area;
+            if (first || growth < best_growth || (growth == best_growth && child_area < best_area)) {
+                best = child;
+                best_growth = growth;
+                best_area = child_area;
+                first = false;
+            }
+        }
+        path.push_back(best);
+    }
+
+    std::size_t carried = id;
+    bool has_carried = true;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        const std::size_t node = *it;
+        if (has_carried) {
+            this->_nodes[node].entries.push_back(carried);
+            has_carried = false;
+        }
+        extend(this->_nodes[node].box, box);
+        if (this->_nodes[node].entries.size() > max_entries) {
+            carried = this->split(node);
+            has_carried = true;
+        }
+    }
+
+    if (has_carried) {
+        std::size_t root = this->new_node(false);
+        this->_nodes[root].entries = {this->_root, carried};
+        this->recompute_box(root);
+        this->_root = root;
+    }
+    return id;
+}
+
+bool SpatialIndex::erase(SpatialIndex::id_t id) {
+    if (id >= this->_boxes.size() || !this->_alive[id])
+        return false;
+
+    const Box &box = this->_boxes[id];
+    // Depth-first search for the leaf holding the id; the stack keeps the
+    // current path together with the next entry to visit on every level.
+    std::vector<std::pair<std::size_t, std::size_t>> path{{this->_root, 0}};
+    bool found = false;
+    while (!path.empty() && !found) {
+        auto &[node, next] = path.back();
+        const Node &n = this->_nodes[node];
+        if (n.leaf) {
+            auto it = std::find(n.entries.begin(), n.entries.end(), id);
+            if (it != n.entries.end()) {
+                this->_nodes[node].entries.erase(it);
+                found = true;
+            } else {
+                path.pop_back();
+            }
+            continue;
+        }
+        while (next < n.entries.size() && !overlaps(this->_nodes[n.entries[next]].box, box)) {
+            ++next;
+        }
+        if (next == n.entries.size()) {
+            path.pop_back();
+        } else {
+            path.emplace_back(n.entries[next++], 0);
+        }
+    }
+
+    // Unlink emptied nodes and shrink the boxes on the way up.
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        const std::size_t node = it->first;
+        if (this->_nodes[node].entries.empty() && it + 1 != path.rend()) {
+            std::vector<std::size_t> &siblings = this->_nodes[(it + 1)->first].entries;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+            this->_free_nodes.push_back(node);
+        } else {
+            this->recompute_box(node);
+        }
+    }
+
+    this->_alive[id] = false;
+    this->_free_ids.push_back(id);
+    if (--this->_size == 0) {
+        this->_nodes.clear();
+        this->_free_nodes.clear();
+        this->_empty = true;
+    }
+    return true;
+}
+
+std::size_t SpatialIndex::size() const {
+    return this->_size;
+}
+
+std::vector<SpatialIndex::id_t> SpatialIndex::containing(const Position &point) const {
+    std::vector<id_t> res;
+    if (this->_empty)
+        return res;
+
+    std::vector<std::size_t> stack{this->_root};
+    while (!stack.empty()) {
+        const Node &n = this->_nodes[stack.back()];
+        stack.pop_back();
+        for (std::size_t entry:n.entries) {
+            if (!contains(this->entry_box(n, entry), point))
+                continue;
+            if (n.leaf) {
+                res.push_back(entry);
+            } else {
+                stack.push_back(entry);
+            }
+        }
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+std::vector<SpatialIndex::id_t> SpatialIndex::overlapping(const Rectangle &window) const {
+    std::vector<id_t> res;
+    if (this->_empty)
+        return res;
+
+    const Box query = box_of(window);
+    std::vector<std::size_t> stack{this->_root};
+    while (!stack.empty()) {
+        const Node &n = this->_nodes[stack.back()];
+        stack.pop_back();
+        for (std::size_t entry:n.entries) {
+            if (!overlaps(this->entry_box(n, entry), query))
+                continue;
+            if (n.leaf) {
+                res.push_back(entry);
+            } else {
+                stack.push_back(entry);
+            }
+        }
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+std::vector<SpatialIndex::id_t> SpatialIndex::nearest(const Position &point, std::size_t k) const {
+    std::vector<id_t> res;
+    if (this->_empty || k == 0)
+        return res;
+
+    // Best-first search: a rectangle popped from the queue is closer than
+    // anything that is still waiting in it.
+    struct Candidate {
+        double distance;
+        bool is_rect;
+        std::size_t index;
+
+        bool operator>(const Candidate &other) const {
+            if (this->distance != other.distance)
+                return this->distance > other.distance;
+            if (this->is_rect != other.is_rect)
+                return !this->is_rect;
+            return this->index > other.index;
+        }
+    };
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> queue;
+    queue.push({0, false, this->_root});
+    while (!queue.empty() && res.size() < k) {
+        Candidate c = queue.top();
+        queue.pop();
+        if (c.is_rect) {
+            res.push_back(c.index);
+            continue;
+        }
+        const Node &n = this->_nodes[c.index];
+        for (std::size_t entry:n.entries) {
+            queue.push({squared_distance(this->entry_box(n, entry), point), n.leaf, entry});
+        }
+    }
+    return res;
+}
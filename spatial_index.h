@@ -0,0 +1,91 @@
+#ifndef JNP1_3_SPATIAL_INDEX_H
+#define JNP1_3_SPATIAL_INDEX_H
+
+#include "geometry.h"
+#include <cstddef>
+#include <vector>
+
+// R-tree over rectangles identified by their index in the source Rectangles
+// (or by the id returned from insert()). insert() reuses the ids of erased
+// rectangles, most recently erased first. A rectangle covers the half-open
+// area [x, x + width) x [y, y + height), so tiles sharing an edge neither
+// overlap nor both contain a point on that edge.
+class SpatialIndex {
+public:
+    using id_t = Rectangles::size_t;
+
+    SpatialIndex() = default;
+
+    // Bulk loads the tree with Sort-Tile-Recursive packing.
+    explicit SpatialIndex(const Rectangles &rects);
+
+    SpatialIndex(const SpatialIndex &other) = default;
+
+    SpatialIndex &operator=(const SpatialIndex &other) = default;
+
+    SpatialIndex(SpatialIndex &&other) = default;
+
+    SpatialIndex &operator=(SpatialIndex &&other) = default;
+
+    id_t insert(const Rectangle &rect);
+
+    // Returns false if there is no rectangle with the given id.
+    bool erase(id_t id);
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Ids of rectangles containing the point, in increasing order.
+    [[nodiscard]] std::vector<id_t> containing(const Position &point) const;
+
+    // Ids of rectangles overlapping the window, in increasing order.
+    [[nodiscard]] std::vector<id_t> overlapping(const Rectangle &window) const;
+
+    // Ids of at most k rectangles closest to the point, nearest first.
+    [[nodiscard]] std::vector<id_t> nearest(const Position &point, std::size_t k) const;
+
+private:
+    struct Box {
+        Vector::coordinate_t x1, y1, x2, y2;
+    };
+
+    struct Node {
+        bool leaf;
+        Box box;
+        // Rectangle ids in leaves, node indices in inner nodes.
+        std::vector<std::size_t> entries;
+    };
+
+    static Box box_of(const Rectangle &rect);
+
+    static bool overlaps(const Box &a, const Box &b);
+
+    static bool contains(const Box &box, const Position &point);
+
+    static void extend(Box &box, const Box &other);
+
+    static double area(const Box &box);
+
+    static double squared_distance(const Box &box, const Position &point);
+
+    [[nodiscard]] const Box &entry_box(const Node &node, std::size_t entry) const;
+
+    void recompute_box(std::size_t node);
+
+    std::size_t new_node(bool leaf);
+
+    std::size_t split(std::size_t node);
+
+    std::vector<std::size_t> pack(std::vector<std::size_t> entries, bool leaf);
+
+    std::vector<Box> _boxes;
+    std::vector<bool> _alive;
+    std::vector<id_t> _free_ids;
+    std::size_t _size = 0;
+
+    std::vector<Node> _nodes;
+    std::vector<std::size_t> _free_nodes;
+    std::size_t _root = 0;
+    bool _empty = true;
+};
+
+#endif //JNP1_3_SPATIAL_INDEX_H
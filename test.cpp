@@ -1,11 +1,28 @@
 #include "geometry.h"
+#include "broad_phase.h"
+#include "coverage.h"
+#include "dirty_region.h"
+#include "hashed_rectangles.h"
+#include "offset_rectangles.h"
+#include "parallel.h"
+#include "rectangles_io.h"
+#include "rectangles_soa.h"
+#include "spatial_index.h"
+#include "transform.h"
 #include <type_traits>
 #include <vector>
+#include <iterator>
 #include <algorithm>
 #include <utility>
 #include <functional>
 #include <limits>
 #include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <memory_resource>
 
 #ifdef NDEBUG
 #undef NDEBUG
@@ -492,6 +509,775 @@ int main() {
     // Rectangles& Rectangles::operator+=(const Vector&)
     assert((std::is_same_v<std::invoke_result_t<decltype(&Rectangles::operator+=), Rectangles, const Vector &>, Rectangles &>));
 
+// ------------- RECTANGLES SOA -------------
+
+    RectanglesSoA soa1{Rectangle(8, 1, {-4, 8}),
+                       Rectangle(71, 23, {5, 6}),
+                       Rectangle(9, 15, {43, 12})};
+    const RectanglesSoA soa2(rs);
+
+    assert(soa1.size() == 3);
+    assert(soa1 == soa2);
+    assert(soa2[1] == Rectangle(71, 23, {5, 6}));
+
+    soa1 += Vector(1, -1);
+    assert(soa1[0] == Rectangle(8, 1, {-3, 7}));
+    assert(soa1[2].pos() == Position(44, 11));
+    assert(!(soa1 == soa2));
+
+    soa1[1] = Rectangle(3, 4);
+    assert(soa1[1].width() == 3 && soa1[1].height() == 4);
+    assert(soa1[1].area() == 12);
+    soa1[1] += Vector(2, 2);
+    assert(soa1[1] == Rectangle(3, 4, {2, 2}));
+    soa1[0] = soa1[1];
+    assert(soa1[0] == Rectangle(3, 4, {2, 2}));
+
+    const RectanglesSoA soa3 = soa2 + Vector(1, 1);
+    assert(soa3[0] == Rectangle(8, 1, {-3, 9}));
+    assert(soa2[0] == Rectangle(8, 1, {-4, 8}));
+
+// ------------- BULK TRANSLATION -------------
+
+    std::vector<Rectangle> layer;
+    for (Vector::coordinate_t i = 0; i < 37; ++i) {
+        layer.emplace_back(i + 1, 2 * i + 1, Position(i, -i));
+    }
+    Rectangles big_layer(layer);
+    big_layer += Vector(-7, 11);
+    big_layer += Vector(minScalar, 0);
+    big_layer += Vector(-static_cast<Vector::coordinate_t>(minScalar), 0);
+    assert(big_layer.size() == layer.size());
+    for (Rectangles::size_t i = 0; i < big_layer.size(); ++i) {
+        assert(big_layer[i] == layer[i] + Vector(-7, 11));
+    }
+
+// ------------- SPATIAL INDEX -------------
+
+    std::vector<Rectangle> tiles;
+    for (Vector::coordinate_t i = 0; i < 40; ++i) {
+        for (Vector::coordinate_t j = 0; j < 25; ++j) {
+            tiles.emplace_back(1 + (i + j) % 4, 1 + (i * j) % 3, Position(3 * i - 50, 2 * j - 20));
+        }
+    }
+    const Rectangles tiles_rects(tiles);
+    SpatialIndex index(tiles_rects);
+    assert(index.size() == tiles.size());
+
+    auto brute_overlapping = [&](const Rectangle &w) {
+        std::vector<SpatialIndex::id_t> res;
+        for (SpatialIndex::id_t i = 0; i < tiles.size(); ++i) {
+            const Rectangle &t = tiles[i];
+            if (t.pos().x() < w.pos().x() + w.width() && w.pos().x() < t.pos().x() + t.width()
+                && t.pos().y() < w.pos().y() + w.height() && w.pos().y() < t.pos().y() + t.height())
+                res.push_back(i);
+        }
+        return res;
+    };
+
+    assert(index.overlapping(Rectangle(17, 9, {-10, -5})) == brute_overlapping(Rectangle(17, 9, {-10, -5})));
+    assert(index.overlapping(Rectangle(1, 1, {1000, 1000})).empty());
+    assert(index.containing({-50, -20}) == std::vector<SpatialIndex::id_t>{0});
+    assert(index.containing({-49, -20}).empty());
+    assert(index.containing({-49, -18}) == std::vector<SpatialIndex::id_t>{1});
+
+    assert(index.nearest({-50, -20}, 1) == std::vector<SpatialIndex::id_t>{0});
+    assert(index.nearest({-1000, -1000}, 1) == std::vector<SpatialIndex::id_t>{0});
+    assert(index.nearest({0, 0}, 5).size() == 5);
+    assert(index.nearest({0, 0}, 5000).size() == tiles.size());
+
+    for (SpatialIndex::id_t i = 0; i < tiles.size(); i += 3) {
+        assert(index.erase(i));
+    }
+    assert(!index.erase(0));
+    assert(index.containing({-50, -20}).empty());
+    SpatialIndex::id_t added = index.insert(Rectangle(5, 5, {-52, -22}));
+    assert(added == (tiles.size() - 1) / 3 * 3);
+    assert(index.containing({-50, -20}) == std::vector<SpatialIndex::id_t>{added});
+
+    SpatialIndex grown;
+    for (const Rectangle &t:tiles) {
+        grown.insert(t);
+    }
+    assert(grown.overlapping(Rectangle(17, 9, {-10, -5})) == brute_overlapping(Rectangle(17, 9, {-10, -5})));
+    assert(grown.overlapping(Rectangle(200, 200, {-100, -100})).size() == tiles.size());
+
+// ------------- UNORDERED MERGE -------------
+
+    assert(merge_unordered({Rectangle(6, 1, {0, 4}),
+                            Rectangle(2, 2, {2, 0}),
+                            Rectangle(2, 1, {0, 1}),
+                            Rectangle(2, 4, {4, 0}),
+                            Rectangle(4, 2, {0, 2}),
+                            Rectangle(2, 1)}) == Rectangle(6, 5));
+    std::vector<Rectangle> grid;
+    for (Vector::coordinate_t i = 0; i < 30; ++i) {
+        for (Vector::coordinate_t j = 0; j < 30; ++j) {
+            grid.emplace_back(1, 2, Position((i * 7) % 30, 2 * ((j * 11) % 30)));
+        }
+    }
+    assert(merge_unordered(Rectangles(grid)) == Rectangle(30, 60));
+    assert(merge_unordered({Rectangle(3, 4, {-105, -213})}) == Rectangle(3, 4, {-105, -213}));
+    assert(merge_unordered(tiles_rects) == std::nullopt);
+    assert(merge_unordered({}) == std::nullopt);
+    // Overlap, gap and a pinwheel, which has no guillotine cut.
+    assert(merge_unordered({Rectangle(2, 2), Rectangle(2, 2)}) == std::nullopt);
+    assert(merge_unordered({Rectangle(2, 2), Rectangle(2, 2, {3, 0})}) == std::nullopt);
+    assert(merge_unordered({Rectangle(2, 1),
+                            Rectangle(1, 2, {2, 0}),
+                            Rectangle(2, 1, {1, 2}),
+                            Rectangle(1, 2, {0, 1}),
+                            Rectangle(1, 1, {1, 1})}) == std::nullopt);
+    assert(merge_unordered({Rectangle(2, 1),
+                            Rectangle(2, 1, {0, 1}),
+                            Rectangle(2, 2, {2, 0}),
+                            Rectangle(4, 2, {0, 2}),
+                            Rectangle(2, 4, {3, 0}),
+                            Rectangle(6, 1, {0, 4})}) == std::nullopt);
+
+    // Strips cut off a square in turn from the left, bottom, right and top,
+    // scrambled. Every cut splits off a single strip.
+    constexpr Vector::coordinate_t spiral_side = 2000;
+    std::vector<Rectangle> spiral_strips;
+    Rectangle spiral_rest(spiral_side, spiral_side);
+    for (Vector::coordinate_t i = 0; i + 1 < spiral_side; ++i) {
+        const Vector::coordinate_t x = spiral_rest.pos().x(), y = spiral_rest.pos().y();
+        const Vector::coordinate_t w = spiral_rest.width(), h = spiral_rest.height();
+        switch (i % 4) {
+            case 0:
+                spiral_strips.emplace_back(1, h, Position(x, y));
+                spiral_rest = Rectangle(w - 1, h, {x + 1, y});
+                break;
+            case 1:
+                spiral_strips.emplace_back(w, 1, Position(x, y));
+                spiral_rest = Rectangle(w, h - 1, {x, y + 1});
+                break;
+            case 2:
+                spiral_strips.emplace_back(1, h, Position(x + w - 1, y));
+                spiral_rest = Rectangle(w - 1, h, {x, y});
+                break;
+            default:
+                spiral_strips.emplace_back(w, 1, Position(x, y + h - 1));
+                spiral_rest = Rectangle(w, h - 1, {x, y});
+                break;
+        }
+    }
+    spiral_strips.push_back(spiral_rest);
+    std::vector<Rectangle> spiral;
+    for (std::size_t i = 0; i < spiral_strips.size(); ++i)
+        spiral.push_back(spiral_strips[i * 1009 % spiral_strips.size()]);
+    assert(merge_unordered(Rectangles(spiral)) == Rectangle(spiral_side, spiral_side));
+    spiral.erase(spiral.begin() + 1234);
+    assert(merge_unordered(Rectangles(spiral)) == std::nullopt);
+    spiral.push_back(spiral_strips[1234 * 1009 % spiral_strips.size()]);
+
+// ------------- COALESCE -------------
+
+    const Rectangles coalesced_grid = coalesce(Rectangles(grid));
+    assert(coalesced_grid.size() == 1);
+    assert(coalesced_grid[0] == Rectangle(30, 60));
+
+    // Columns of different widths cannot become one rectangle.
+    const Rectangles columns = coalesce({Rectangle(1, 1, {0, 0}),
+                                         Rectangle(2, 1, {1, 0}),
+                                         Rectangle(1, 1, {0, 1}),
+                                         Rectangle(2, 1, {1, 1}),
+                                         Rectangle(1, 3, {0, 2}),
+                                         Rectangle(5, 5, {10, 10})});
+    assert(columns.size() == 3);
+    assert(columns[0] == Rectangle(1, 5, {0, 0}));
+    assert(columns[1] == Rectangle(2, 2, {1, 0}));
+    assert(columns[2] == Rectangle(5, 5, {10, 10}));
+
+    const Rectangles separate = coalesce({Rectangle(2, 2), Rectangle(2, 2, {3, 0})});
+    assert(separate.size() == 2);
+    assert(coalesce({}).size() == 0);
+    const Rectangles coalesced_spiral = coalesce(Rectangles(spiral));
+    assert(coalesced_spiral.size() == 1 && coalesced_spiral[0] == Rectangle(spiral_side, spiral_side));
+    const Rectangles duplicates = coalesce({Rectangle(2, 2), Rectangle(2, 2), Rectangle(2, 1, {0, 2})});
+    assert(duplicates.size() == 2 && duplicates[0] == Rectangle(2, 3) && duplicates[1] == Rectangle(2, 2));
+
+// ------------- PARALLEL MERGE -------------
+
+    const Rectangles chain{Rectangle(2, 1),
+                           Rectangle(2, 1, {0, 1}),
+                           Rectangle(2, 2, {2, 0}),
+                           Rectangle(4, 2, {0, 2}),
+                           Rectangle(2, 4, {4, 0}),
+                           Rectangle(6, 1, {0, 4})};
+    ParallelExecutor merge_executor(3);
+    assert(merge_all_parallel(merge_executor, chain) == merge_all(chain));
+    assert(merge_all_parallel(merge_executor, chain, 2) == Rectangle(6, 5));
+    assert(merge_all_parallel(merge_executor, {}) == std::nullopt);
+    assert(merge_all_parallel(merge_executor, {Rectangle(2, 1), Rectangle(1, 1, {0, 1}), Rectangle(1, 1, {1, 1})},
+                              1) == std::nullopt);
+
+    std::vector<Rectangle> long_row;
+    Vector::coordinate_t row_end = 5;
+    for (Vector::coordinate_t i = 0; i < 100000; ++i) {
+        long_row.emplace_back(1 + i % 3, 4, Position(row_end, -2));
+        row_end += 1 + i % 3;
+    }
+    Rectangles long_rects(long_row);
+    assert(merge_all_parallel(merge_executor, long_rects, 1000) == merge_all(long_rects));
+    long_row[70000] += Vector(0, 1);
+    assert(merge_all_parallel(merge_executor, Rectangles(long_row), 1000) == std::nullopt);
+
+// ------------- CONSTEXPR -------------
+
+    constexpr Rectangle cmr1{4, 5, {3, 7}};
+    constexpr Rectangle cmr2 = Rectangle(4, 1) + Vector(3, 12);
+    static_assert(cmr2 == Rectangle(4, 1, {3, 12}));
+    static_assert(merge_horizontally(cmr1, cmr2) == Rectangle(4, 6, {3, 7}));
+    static_assert(merge_vertically(Rectangle(4, 5), Rectangle(1, 5, {4, 0})) == Rectangle(5, 5));
+    static_assert(can_be_merged_horizontally(cmr1, cmr2) && !can_be_merged_vertically(cmr1, cmr2));
+    static_assert(cmr1.area() == 20);
+    static_assert(cmr1.reflection() == Rectangle(5, 4, {7, 3}));
+    static_assert(Position::origin() == Position(0, 0));
+    static_assert(Vector(Position(1, 2)).reflection() == Vector(2, 1));
+    static_assert((Vector(1, 2) += Vector(3, 4)) == Vector(4, 6));
+    static_assert(Vector(1, 2) + Position(3, 4) == Position(4, 6));
+
+// ------------- COORDINATE TYPES -------------
+
+    static_assert(std::is_same_v<Vector, basic_vector<int_fast32_t>>);
+    static_assert(std::is_same_v<Rectangle::area_t, uint_fast32_t>);
+    static_assert(sizeof(basic_rectangle<int16_t>) == 4 * sizeof(int16_t));
+    static_assert(std::is_same_v<basic_rectangle<int16_t>::area_t, unsigned int>);
+    static_assert(std::is_same_v<basic_rectangle<double>::area_t, double>);
+
+    basic_rectangles<int16_t> small_tiles{basic_rectangle<int16_t>(2, 1),
+                                          basic_rectangle<int16_t>(2, 1, {0, 1}),
+                                          basic_rectangle<int16_t>(1, 2, {2, 0})};
+    small_tiles += basic_vector<int16_t>(-1, 3);
+    assert(small_tiles[2] == basic_rectangle<int16_t>(1, 2, {1, 3}));
+    assert(merge_all(small_tiles) == basic_rectangle<int16_t>(3, 2, {-1, 3}));
+    assert(basic_rectangle<int16_t>(300, 300).area() == 90000);
+
+    const basic_rectangle<double> body(0.5, 2.0, {0.25, -1.0});
+    assert((body + basic_vector<double>(0.25, 1.0)).pos() == basic_position<double>(0.5, 0.0));
+    assert(body.area() == 1.0);
+    assert(body.reflection() == basic_rectangle<double>(2.0, 0.5, {-1.0, 0.25}));
+
+// ------------- ALLOCATORS -------------
+
+    std::pmr::monotonic_buffer_resource arena;
+    const pmr::Rectangles arena_rects({Rectangle(2, 1), Rectangle(2, 1, {0, 1})}, &arena);
+    pmr::Rectangles arena_moved = arena_rects + Vector(1, 1);
+    assert(arena_moved.get_allocator().resource() == &arena);
+    assert(arena_moved[1] == Rectangle(2, 1, {1, 2}));
+    arena_moved = std::move(arena_moved) + Vector(-1, -1);
+    assert(arena_moved.get_allocator().resource() == &arena);
+    assert(merge_all(arena_moved) == Rectangle(2, 2));
+    const pmr::Rectangles heap_copy(arena_rects, std::pmr::new_delete_resource());
+    assert(heap_copy.get_allocator().resource() == std::pmr::new_delete_resource());
+    assert(heap_copy[0] == Rectangle(2, 1));
+
+// ------------- LAZY TRANSLATION -------------
+
+    const Vector lv1(1, 2), lv2(-3, 5), lv3(10, 0);
+    auto lazy = crs + lv1 + lv2 + lv3;
+    static_assert(std::is_same_v<decltype(lazy), TranslatedRectangles>);
+    assert(lazy.offset() == Vector(8, 7));
+    assert(&lazy.source() == &crs);
+    assert(lazy.size() == crs.size());
+    assert(lazy[1] == Rectangle(71, 23, {13, 13}));
+    assert((lv1 + (lv2 + crs))[0] == Rectangle(8, 1, {-6, 15}));
+
+    const Rectangles materialized = crs + lv1 + lv2 + lv3;
+    for (Rectangles::size_t i = 0; i < crs.size(); ++i) {
+        assert(materialized[i] == crs[i] + Vector(8, 7));
+    }
+    assert(merge_all(chain + lv1) == Rectangle(6, 5, {1, 2}));
+    assert((crs + lv1 + lv2 + lv3) == materialized && materialized == lazy && !(lazy != materialized));
+    assert(crs + lv1 != materialized && lazy == crs + Vector(8, 7) && lazy != crs + lv1);
+    assert(!lazy.empty() && (Rectangles() + lv1).empty());
+    Rectangles::size_t lazy_index = 0;
+    for (const Rectangle &rect:crs + Vector(8, 7))
+        assert(rect == materialized[lazy_index++]);
+    assert(lazy_index == crs.size());
+    assert(std::vector<Rectangle>(lazy.begin(), lazy.end()).size() == crs.size());
+
+// ------------- OFFSET RECTANGLES -------------
+
+    OffsetRectangles offset_rects(chain);
+    offset_rects += Vector(1, 2);
+    offset_rects += Vector(2, -1);
+    assert(offset_rects.offset() == Vector(3, 1));
+    assert(offset_rects.storage()[0] == Rectangle(2, 1));
+    assert(offset_rects[0] == Rectangle(2, 1, {3, 1}));
+    assert(merge_all(offset_rects) == Rectangle(6, 5, {3, 1}));
+
+    Rectangles::size_t visited = 0;
+    for (const Rectangle &rect:offset_rects) {
+        assert(rect == chain[visited] + Vector(3, 1));
+        ++visited;
+    }
+    assert(visited == chain.size());
+
+    OffsetRectangles offset_flushed = offset_rects;
+    offset_flushed.flush();
+    assert(offset_flushed.offset() == Vector(0, 0));
+    assert(offset_flushed == offset_rects);
+    offset_flushed.set(0, Rectangle(9, 9));
+    assert(offset_flushed[0] == Rectangle(9, 9));
+    assert(!(offset_flushed == offset_rects));
+
+    offset_rects.set(5, Rectangle(6, 1, {3, 5}));
+    assert(offset_rects.storage()[5] == Rectangle(6, 1, {0, 4}));
+
+    OffsetRectangles offset_moved = std::move(offset_rects) + Vector(-3, -1);
+    assert(offset_moved[5] == Rectangle(6, 1, {0, 4}));
+    const Rectangles offset_out = std::move(offset_moved).rectangles();
+    assert(offset_out.size() == chain.size());
+    assert(offset_out[1] == chain[1]);
+
+// ------------- INTERSECTION AND CLIPPING -------------
+
+    constexpr Rectangle ir1(4, 4), ir2(4, 4, {2, 3});
+    static_assert(intersection(ir1, ir2) == Rectangle(2, 1, {2, 3}));
+    static_assert(intersection(ir1, Rectangle(1, 1, {4, 0})) == std::nullopt);
+    static_assert(intersects(ir1, ir2) && !intersects(ir1, Rectangle(1, 1, {0, 4})));
+    static_assert(bounding_union(ir1, ir2) == Rectangle(6, 7));
+    static_assert(contains(ir1, Position(3, 3)) && !contains(ir1, Position(4, 3)));
+    static_assert(contains(ir1, Rectangle(2, 2, {2, 2})) && !contains(ir1, ir2));
+
+    const Rectangle viewport(17, 9, {-10, -5});
+    Rectangles clipped{Rectangle(1, 1)};
+    tiles_rects.clip(viewport, clipped);
+    Rectangles culled;
+    tiles_rects.cull(viewport, culled);
+    Rectangles::size_t clip_index = 0;
+    for (const Rectangle &t:tiles) {
+        if (auto part = intersection(t, viewport)) {
+            assert(clipped[clip_index] == *part);
+            assert(culled[clip_index] == t);
+            ++clip_index;
+        }
+    }
+    assert(clipped.size() == clip_index && culled.size() == clip_index);
+    assert(clip_index == brute_overlapping(viewport).size());
+    tiles_rects.clip(Rectangle(1, 1, {1000, 1000}), clipped);
+    assert(clipped.size() == 0);
+    Rectangles culled_in_place(tiles_rects);
+    culled_in_place.cull(viewport, culled_in_place);
+    assert(culled_in_place == culled);
+    Rectangles clipped_in_place(tiles_rects);
+    tiles_rects.clip(viewport, clipped);
+    clipped_in_place.clip(viewport, clipped_in_place);
+    assert(clipped_in_place == clipped);
+    Rectangles survivors{Rectangle(1, 1, {5, 5}), Rectangle(2, 2), Rectangle(1, 1, {-5, 0}), Rectangle(3, 1)};
+    survivors.cull(Rectangle(4, 4), survivors);
+    assert(survivors == Rectangles({Rectangle(2, 2), Rectangle(3, 1)}));
+
+// ------------- BROAD PHASE -------------
+
+    std::vector<Rectangle> scattered;
+    for (Vector::coordinate_t i = 0; i < 9000; ++i) {
+        scattered.emplace_back(1 + i % 13, 1 + i % 7, Position((i * 7919) % 2000, (i * 104729) % 300));
+    }
+    const Rectangles scattered_rects(scattered);
+    std::vector<OverlapPair> naive_pairs;
+    for (Rectangles::size_t i = 0; i < scattered.size(); ++i) {
+        for (Rectangles::size_t j = i + 1; j < scattered.size(); ++j) {
+            if (intersects(scattered[i], scattered[j]))
+                naive_pairs.emplace_back(i, j);
+        }
+    }
+    std::vector<OverlapPair> swept_pairs{{7, 7}};
+    find_overlaps(scattered_rects, swept_pairs);
+    std::sort(swept_pairs.begin(), swept_pairs.end());
+    assert(!naive_pairs.empty());
+    assert(swept_pairs == naive_pairs);
+    find_overlaps(merge_executor, scattered_rects, swept_pairs, 7);
+    std::sort(swept_pairs.begin(), swept_pairs.end());
+    assert(swept_pairs == naive_pairs);
+    find_overlaps(chain, swept_pairs);
+    assert(swept_pairs.empty());
+
+// ------------- COVERED AREA -------------
+
+    assert(covered_area({}) == 0);
+    assert(covered_area(chain) == 30);
+    assert(covered_area({Rectangle(4, 4), Rectangle(4, 4, {2, 3}), Rectangle(4, 4)}) == 16 + 16 - 2);
+    assert(covered_area({Rectangle(10, 10), Rectangle(2, 2, {3, 3})}) == 100);
+
+    std::vector<char> painted(2020 * 310, false);
+    for (const Rectangle &rect:scattered) {
+        for (Vector::coordinate_t x = rect.pos().x(); x < rect.pos().x() + rect.width(); ++x) {
+            for (Vector::coordinate_t y = rect.pos().y(); y < rect.pos().y() + rect.height(); ++y) {
+                painted[x * 310 + y] = true;
+            }
+        }
+    }
+    assert(covered_area(scattered_rects) == static_cast<wide_area_t>(std::count(painted.begin(), painted.end(), true)));
+
+    const Vector::coordinate_t huge = std::numeric_limits<int32_t>::max();
+    const wide_area_t huge_area = covered_area({Rectangle(huge, huge), Rectangle(huge, huge, {huge, 0}),
+                                                Rectangle(huge, huge, {0, huge}), Rectangle(huge, huge, {huge, huge})});
+    assert(huge_area == 4 * static_cast<wide_area_t>(huge) * static_cast<wide_area_t>(huge));
+
+// ------------- CHECKED ARITHMETIC -------------
+
+    static_assert(checked_area(Rectangle(3, 4)) == 12u);
+    static_assert(wide_area(Rectangle(3, 4)) == 12u);
+    const Vector::coordinate_t limit = std::numeric_limits<Vector::coordinate_t>::max();
+    const Rectangle::area_t area_limit = std::numeric_limits<Rectangle::area_t>::max();
+    assert(checked_area(Rectangle(limit, 1)) == static_cast<Rectangle::area_t>(limit));
+    assert(!checked_area(Rectangle(limit, limit)).has_value());
+    assert(saturating_area(Rectangle(limit, limit)) == area_limit);
+    assert(saturating_area(Rectangle(5, 6)) == 30u);
+    assert(wide_area(Rectangle(limit, limit)) == static_cast<wide_area_t>(limit) * static_cast<wide_area_t>(limit));
+
+    assert(merge_all<checked_arithmetic>(chain) == merge_all(chain));
+    assert(merge_horizontally<checked_arithmetic>(Rectangle(2, 3), Rectangle(2, 4, {0, 3})) == Rectangle(2, 7));
+    bool overflowed = false;
+    try {
+        merge_vertically<checked_arithmetic>(Rectangle(limit, 1, {1, 0}), Rectangle(limit, 1, {limit, 0}));
+    } catch (const std::overflow_error &) {
+        overflowed = true;
+    }
+    assert(overflowed);
+
+// ------------- SERIALIZATION -------------
+
+    for (RectanglesEncoding encoding:{RectanglesEncoding::raw, RectanglesEncoding::delta_varint}) {
+        for (const Rectangles &stored:{Rectangles(), chain, scattered_rects, Rectangles({Rectangle(limit, limit, {-limit, limit})})}) {
+            std::stringstream stream;
+            write_rectangles(stream, stored, encoding);
+            std::optional<Rectangles> loaded = read_rectangles(stream);
+            assert(loaded.has_value() && loaded->size() == stored.size());
+            for (Rectangles::size_t i = 0; i < stored.size(); ++i)
+                assert((*loaded)[i] == stored[i]);
+        }
+    }
+
+    std::stringstream raw_stream, packed_stream;
+    write_rectangles(raw_stream, scattered_rects);
+    write_rectangles(packed_stream, scattered_rects, RectanglesEncoding::delta_varint);
+    assert(packed_stream.str().size() < raw_stream.str().size() / 4);
+
+    std::string truncated = packed_stream.str();
+    truncated.pop_back();
+    std::istringstream truncated_stream(truncated);
+    assert(!read_rectangles(truncated_stream).has_value());
+    std::istringstream garbage_stream("not a rectangles file");
+    assert(!read_rectangles(garbage_stream).has_value());
+    // The x column of a single rectangle, replaced by the longest varint:
+    // the tenth byte may only carry the top bit.
+    std::stringstream one_rect_stream;
+    write_rectangles(one_rect_stream, Rectangles({Rectangle(1, 1)}), RectanglesEncoding::delta_varint);
+    const std::string one_rect = one_rect_stream.str();
+    const std::string widest = one_rect.substr(0, one_rect.size() - 4) + std::string(9, '\xff');
+    std::istringstream widest_stream(widest + '\x01' + one_rect.substr(one_rect.size() - 3));
+    const std::optional<Rectangles> widest_loaded = read_rectangles(widest_stream);
+    assert(widest_loaded.has_value()
+           && (*widest_loaded)[0].pos().x() == std::numeric_limits<Vector::coordinate_t>::min());
+    std::istringstream overlong_stream(widest + '\x7f' + one_rect.substr(one_rect.size() - 3));
+    assert(!read_rectangles(overlong_stream).has_value());
+
+    const std::string mapped_path = (std::filesystem::temp_directory_path() / "jnp1_3_rectangles.bin").string();
+    {
+        std::ofstream file(mapped_path, std::ios::binary);
+        write_rectangles(file, scattered_rects);
+    }
+    {
+        std::optional<MappedRectangles> mapped = MappedRectangles::open(mapped_path);
+        assert(mapped.has_value() && mapped->size() == scattered_rects.size());
+        for (Rectangles::size_t i = 0; i < scattered_rects.size(); ++i)
+            assert((*mapped)[i] == scattered_rects[i]);
+        MappedRectangles moved = std::move(*mapped);
+        assert(moved.size() == scattered_rects.size() && moved[7] == scattered_rects[7]);
+        bool out_of_range = false;
+        try {
+            (void) moved[moved.size()];
+        } catch (const std::out_of_range &) {
+            out_of_range = true;
+        }
+        assert(out_of_range);
+    }
+    {
+        std::ofstream file(mapped_path, std::ios::binary);
+        write_rectangles(file, scattered_rects, RectanglesEncoding::delta_varint);
+    }
+    assert(!MappedRectangles::open(mapped_path).has_value());
+    std::filesystem::remove(mapped_path);
+    assert(!MappedRectangles::open(mapped_path).has_value());
+
+// ------------- STREAMING MERGE -------------
+
+    assert(merge_stream(OffsetRectangles(chain)).rect == merge_all(chain));
+    assert(merge_stream(OffsetRectangles(chain) + Vector(1, 1)).rect == merge_all(chain) + Vector(1, 1));
+    const MergeResult empty_merge = merge_stream(std::vector<Rectangle>());
+    assert(!empty_merge.rect.has_value() && !empty_merge.failed_at.has_value());
+    const std::vector<Rectangle> broken{Rectangle(2, 3), Rectangle(2, 4, {0, 3}), Rectangle(1, 1, {10, 10}),
+                                        Rectangle(3, 7, {2, 0})};
+    const MergeResult broken_merge = merge_stream(broken.begin(), broken.end());
+    assert(!broken_merge.rect.has_value() && broken_merge.failed_at == 2u);
+    assert(merge_stream(broken.begin(), broken.begin() + 2).rect == Rectangle(2, 7));
+
+    MergeAccumulator strip_acc;
+    for (Vector::coordinate_t x = 0; x < 1000; ++x)
+        assert(strip_acc.push(Rectangle(1, 4, {x, 0})));
+    assert(!strip_acc.push(Rectangle(1, 5, {1000, 0})));
+    assert(strip_acc.count() == 1000 && strip_acc.result() == Rectangle(1000, 4));
+
+    {
+        std::ofstream file(mapped_path, std::ios::binary);
+        write_rectangles(file, chain);
+    }
+    {
+        std::optional<MappedRectangles> mapped = MappedRectangles::open(mapped_path);
+        assert(mapped.has_value() && merge_stream(*mapped).rect == merge_all(chain));
+    }
+    std::filesystem::remove(mapped_path);
+
+// ------------- ITERATORS -------------
+
+    static_assert(std::is_same_v<std::iterator_traits<Rectangles::iterator>::iterator_category,
+            std::random_access_iterator_tag>);
+    Rectangles built;
+    assert(built.empty());
+    built.reserve(3);
+    assert(built.capacity() >= 3);
+    const Rectangle *built_storage = built.data();
+    built.push_back(Rectangle(3, 1, {0, 2}));
+    assert(built.emplace_back(2, 2, Position(0, 0)) == Rectangle(2, 2));
+    built.emplace_back(1, 2);
+    assert(built.size() == 3 && built.data() == built_storage);
+    assert(built.unchecked(2) == built[2] && &built.unchecked(0) == built.data());
+
+    std::sort(built.begin(), built.end(), [](const Rectangle &a, const Rectangle &b) {
+        return a.area() < b.area();
+    });
+    assert(built[0] == Rectangle(1, 2) && built[1] == Rectangle(3, 1, {0, 2}) && built[2] == Rectangle(2, 2));
+    Rectangle::area_t built_area = 0;
+    for (const Rectangle &rect:built)
+        built_area += rect.area();
+    assert(built_area == 9);
+    for (Rectangle &rect:built)
+        rect += Vector(1, 1);
+    assert(built.cbegin()->pos() == Position(1, 1) && std::prev(built.cend())->pos() == Position(1, 1));
+    assert(std::distance(crs.begin(), crs.end()) == static_cast<std::ptrdiff_t>(crs.size()));
+    assert(merge_stream(chain).rect == merge_all(chain));
+
+// ------------- STORAGE REUSE -------------
+
+    Rectangles frame_out;
+    chain.translate_into(frame_out, Vector(1, 2));
+    assert(frame_out.size() == chain.size() && merge_all(frame_out) == merge_all(chain) + Vector(1, 2));
+    const Rectangle *frame_storage = frame_out.data();
+    chain.translate_into(frame_out, Vector(-1, 0));
+    assert(frame_out.data() == frame_storage && frame_out[0] == chain[0] + Vector(-1, 0));
+    frame_out.clear();
+    assert(frame_out.empty() && frame_out.capacity() >= chain.size());
+    frame_out.emplace_back(4, 4);
+    assert(frame_out.data() == frame_storage);
+
+    Rectangles to_coalesce(chain);
+    const Rectangle *coalesce_storage = to_coalesce.data();
+    const Rectangles coalesced_chain = coalesce(std::move(to_coalesce));
+    assert(coalesced_chain.size() == 1 && coalesced_chain[0] == merge_all(chain));
+    assert(coalesced_chain.data() == coalesce_storage);
+
+// ------------- EQUALITY AND HASH -------------
+
+    const Rectangles chain_copy(chain);
+    assert(chain_copy == chain && !(chain_copy != chain));
+    assert(!(crs == chain) && crs != Rectangles());
+    assert(Rectangles() == Rectangles());
+    Rectangles one_off(chain);
+    one_off[3] += Vector(0, 1);
+    assert(one_off != chain && one_off.hash() != chain.hash());
+    one_off[3] += Vector(0, -1);
+    assert(one_off == chain && one_off.hash() == chain.hash());
+
+    Rectangles held(chain);
+    Rectangle &held_ref = held[0];
+    const std::size_t held_hash = held.hash();
+    held_ref += Vector(1, 0);
+    assert(held != chain && held.hash() != held_hash);
+    held_ref += Vector(-1, 0);
+    assert(held == chain && held.hash() == held_hash);
+
+    HashedRectangles hashed;
+    for (Rectangles::size_t i = 0; i < chain.size(); ++i)
+        hashed.emplace_back(chain[i]);
+    assert(hashed.hash() == chain.hash() && std::hash<HashedRectangles>()(hashed) == chain.hash());
+    assert(hashed == HashedRectangles(chain) && hashed.rectangles() == chain);
+    hashed += Vector(5, -7);
+    const Rectangles shifted_chain(std::vector<Rectangle>(hashed.begin(), hashed.end()));
+    assert(hashed.hash() == shifted_chain.hash() && hashed.rectangles() == shifted_chain);
+    chain.translate_into(frame_out, Vector(5, -7));
+    assert(frame_out.hash() == shifted_chain.hash());
+    frame_out.translate_into(frame_out, Vector(-5, 7));
+    assert(frame_out == chain);
+    hashed.set(2, Rectangle(1, 1));
+    assert(hashed.hash() == hashed.rectangles().hash() && hashed.hash() != shifted_chain.hash());
+    hashed.set(2, shifted_chain[2]);
+    assert(hashed.hash() == shifted_chain.hash() && hashed == HashedRectangles(shifted_chain));
+    hashed.reflect();
+    assert(hashed.hash() == hashed.rectangles().hash());
+    hashed.reflect();
+    hashed.push_back(Rectangle(1, 1));
+    assert(hashed.hash() != shifted_chain.hash() && hashed != HashedRectangles(shifted_chain));
+    HashedRectangles hash_moved = std::move(hashed);
+    assert(hash_moved.size() == chain.size() + 1 && hash_moved.hash() == hash_moved.rectangles().hash());
+    hashed.clear();
+    assert(hashed.hash() == Rectangles().hash() && hashed == HashedRectangles());
+
+    using HashedRectangles16 = basic_hashed_rectangles<int16_t>;
+    constexpr int16_t max16 = std::numeric_limits<int16_t>::max();
+    HashedRectangles16 wrapping{basic_rectangle<int16_t>(1, 1, {max16, 0}), basic_rectangle<int16_t>(2, 3, {-4, 5})};
+    wrapping += basic_vector<int16_t>(1, 0);
+    assert(wrapping[0].pos().x() == std::numeric_limits<int16_t>::min());
+    const HashedRectangles16 wrapped(wrapping.rectangles());
+    assert(wrapping.hash() == wrapped.hash() && wrapping == wrapped);
+
+// ------------- BATCH REFLECTION -------------
+
+    Rectangles reflected(scattered_rects);
+    reflected.reflect();
+    assert(reflected.size() == scattered_rects.size());
+    for (Rectangles::size_t i = 0; i < scattered_rects.size(); ++i)
+        assert(reflected[i] == scattered_rects[i].reflection());
+    assert(reflected.hash() != scattered_rects.hash());
+    reflected.reflect();
+    assert(reflected == scattered_rects && reflected.hash() == scattered_rects.hash());
+    Rectangles reflected_odd{Rectangle(1, 2, {3, 4}), Rectangle(5, 6, {-7, 8}), Rectangle(9, 10, {11, -12})};
+    reflected_odd.reflect();
+    assert(reflected_odd == Rectangles({Rectangle(2, 1, {4, 3}), Rectangle(6, 5, {8, -7}),
+                                        Rectangle(10, 9, {-12, 11})}));
+    Rectangles reflected_empty;
+    reflected_empty.reflect();
+    assert(reflected_empty.empty());
+
+    RectanglesSoA reflected_soa(chain);
+    reflected_soa.reflect();
+    for (RectanglesSoA::size_t i = 0; i < chain.size(); ++i)
+        assert(std::as_const(reflected_soa)[i] == chain[i].reflection());
+
+// ------------- TRANSFORMS -------------
+
+    constexpr Transform quarter = Transform::rotation(1);
+    static_assert(quarter * quarter == Transform::rotation(2));
+    static_assert(quarter * quarter * quarter * quarter == Transform());
+    static_assert(Transform::rotation(-1) == Transform::rotation(3));
+    static_assert(Transform::reflection_x() * Transform::reflection_y() == Transform::rotation(2));
+    static_assert(quarter(Position(1, 0)) == Position(0, 1));
+    static_assert(quarter(Vector(2, 3)) == Vector(-3, 2));
+    static_assert(Transform::reflection()(Rectangle(2, 3, {4, 5})) == Rectangle(2, 3, {4, 5}).reflection());
+    static_assert(Transform::reflection_y()(Rectangle(2, 3, {4, 5})) == Rectangle(2, 3, {-6, 5}));
+    static_assert(Transform::reflection_x()(Rectangle(2, 3, {4, 5})) == Rectangle(2, 3, {4, -8}));
+    static_assert(quarter(Rectangle(2, 3, {4, 5})) == Rectangle(3, 2, {-8, 4}));
+    static_assert(Transform::scaling(2, -3)(Rectangle(2, 3, {4, 5})) == Rectangle(4, 9, {8, -24}));
+    static_assert(Transform::translation(Vector(1, 2))(Position(3, 4)) == Position(4, 6));
+
+    constexpr Transform pipeline = Transform::translation(Vector(1, -2))
+            .then(quarter)
+            .then(Transform::scaling(3, 2))
+            .then(Transform::reflection_x())
+            .then(Transform::translation(Vector(10, 0)));
+    static_assert(!pipeline.is_translation());
+    for (const Rectangle &rect:scattered_rects) {
+        const Rectangle stepwise = Transform::translation(Vector(10, 0))(Transform::reflection_x()(
+                Transform::scaling(3, 2)(quarter(rect + Vector(1, -2)))));
+        assert(pipeline(rect) == stepwise);
+        assert(covered_area({pipeline(rect)}) == 6 * wide_area(rect));
+    }
+    assert(pipeline.then(Transform::translation(Vector(-10, 0))).offset() == pipeline(Vector(1, -2)));
+
+    Rectangles transformed(scattered_rects);
+    transform_all(transformed, pipeline);
+    assert(transformed == pipeline(scattered_rects));
+    for (Rectangles::size_t i = 0; i < scattered_rects.size(); ++i)
+        assert(transformed[i] == pipeline(scattered_rects[i]));
+    transformed = scattered_rects;
+    transform_all(transformed, Transform::translation(Vector(4, 4)));
+    assert(transformed == scattered_rects + Vector(4, 4));
+    transform_all(transformed, Transform::reflection());
+    assert(transformed[0] == (scattered_rects[0] + Vector(4, 4)).reflection());
+    assert(covered_area(pipeline(scattered_rects)) == 6 * covered_area(scattered_rects));
+
+// ------------- PARALLEL EXECUTOR -------------
+
+    ParallelExecutor executor(4);
+    assert(executor.concurrency() == 4);
+    std::vector<int> visits(1001, 0);
+    executor.for_chunks(visits.size(), 10, [&](std::size_t first, std::size_t last) {
+        assert(last - first <= 10);
+        for (std::size_t i = first; i < last; ++i)
+            ++visits[i];
+    });
+    assert(std::count(visits.begin(), visits.end(), 1) == static_cast<std::ptrdiff_t>(visits.size()));
+    executor.for_chunks(0, 10, [](std::size_t, std::size_t) { assert(false); });
+
+    Rectangles par_rects(scattered_rects);
+    parallel_translate(executor, par_rects, Vector(-3, 8), 7);
+    assert(par_rects == scattered_rects + Vector(-3, 8));
+    HashedRectangles par_hashed(scattered_rects);
+    parallel_translate(executor, par_hashed, Vector(-3, 8), 7);
+    assert(par_hashed.rectangles() == par_rects && par_hashed.hash() == par_rects.hash());
+    parallel_reflect(executor, par_rects, 5);
+    Rectangles seq_rects(scattered_rects + Vector(-3, 8));
+    seq_rects.reflect();
+    assert(par_rects == seq_rects);
+
+    wide_area_t seq_area = 0;
+    for (const Rectangle &rect:scattered_rects)
+        seq_area += rect.area();
+    assert(parallel_total_area(executor, scattered_rects, 3) == seq_area);
+    assert(parallel_total_area(executor, Rectangles()) == 0);
+
+    Rectangles par_culled, seq_culled;
+    const Rectangle cull_view(300, 100, {500, 50});
+    scattered_rects.cull(cull_view, seq_culled);
+    parallel_cull(executor, scattered_rects, cull_view, par_culled, 6);
+    assert(!seq_culled.empty() && par_culled == seq_culled);
+    ParallelExecutor single(1);
+    parallel_cull(single, scattered_rects, cull_view, par_culled, 6);
+    assert(par_culled == seq_culled);
+    Rectangles par_in_place(scattered_rects), seq_in_place(scattered_rects);
+    parallel_cull(executor, par_in_place, cull_view, par_in_place, 6);
+    seq_in_place.cull(cull_view, seq_in_place);
+    assert(par_in_place == seq_culled && par_in_place == seq_in_place);
+
+// ------------- DIRTY REGION -------------
+
+    DirtyRegion dirty;
+    assert(dirty.empty() && !dirty.bounds().has_value() && dirty.area() == 0);
+    for (Vector::coordinate_t y = 0; y < 60; y += 2) {
+        for (Vector::coordinate_t x = 0; x < 30; ++x)
+            dirty.insert(Rectangle(1, 2, {x, y}));
+    }
+    assert(dirty.size() == 1 && dirty.rectangles()[0] == Rectangle(30, 60));
+    assert(dirty.bounds() == Rectangle(30, 60) && dirty.area() == 1800);
+    dirty.insert(Rectangle(5, 5, {3, 3}));
+    assert(dirty.size() == 1 && dirty.area() == 1800);
+    dirty.insert(Rectangle(10, 60, {25, 0}));
+    assert(dirty.size() == 1 && dirty.rectangles()[0] == Rectangle(35, 60));
+
+    dirty.clear();
+    assert(dirty.empty() && dirty.area() == 0);
+    for (const Rectangle &rect:grid)
+        dirty.insert(rect);
+    assert(dirty.area() == 1800 && dirty.bounds() == Rectangle(30, 60));
+    assert(dirty.size() < grid.size() && covered_area(dirty.rectangles()) == 1800);
+
+    dirty.clear();
+    for (const Rectangle &rect:scattered_rects)
+        dirty.insert(rect);
+    const Rectangles dirty_rects = dirty.rectangles();
+    assert(dirty_rects.size() == dirty.size());
+    assert(dirty.area() == covered_area(scattered_rects) && covered_area(dirty_rects) == dirty.area());
+    std::vector<OverlapPair> dirty_overlaps;
+    find_overlaps(dirty_rects, dirty_overlaps);
+    assert(dirty_overlaps.empty());
+    Rectangle dirty_bounds = scattered_rects[0];
+    for (const Rectangle &rect:scattered_rects)
+        dirty_bounds = bounding_union(dirty_bounds, rect);
+    assert(dirty.bounds() == dirty_bounds);
+
 //     DNC: pos27 = vec26;
 //     DNC: vec26 = pos27;
 //     DNC: Position pos28 = vec27;
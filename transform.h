@@ -0,0 +1,218 @@
+#ifndef JNP1_3_TRANSFORM_H
+#define JNP1_3_TRANSFORM_H
+
+#include "geometry.h"
+#include <cassert>
+#include <cstddef>
+
+// Axis-preserving affine map p -> M p + offset, where M is a scaled signed
+// permutation matrix: a composition of translations, reflections across
+// the axes, quarter turns and integer scalings. Such maps send rectangles to
+// rectangles, so a whole chain of them is applied in one pass. Everything is
+// constexpr, so compositions of constants are folded at compile time.
+template<typename T>
+class basic_transform {
+public:
+    // The identity.
+    constexpr basic_transform();
+
+    static constexpr basic_transform translation(const basic_vector<T> &vec);
+
+    // Multiplies x by sx and y by sy, both nonzero.
+    static constexpr basic_transform scaling(T sx, T sy);
+
+    // (x, y) -> (x, -y).
+    static constexpr basic_transform reflection_x();
+
+    // (x, y) -> (-x, y).
+    static constexpr basic_transform reflection_y();
+
+    // (x, y) -> (y, x), the reflection() of the value types.
+    static constexpr basic_transform reflection();
+
+    // Rotation by quarter_turns right angles counterclockwise about the origin.
+    static constexpr basic_transform rotation(int quarter_turns);
+
+    // The map applying other first and then *this.
+    constexpr basic_transform operator*(const basic_transform &other) const;
+
+    // The map applying *this first and then next.
+    [[nodiscard]] constexpr basic_transform then(const basic_transform &next) const;
+
+    constexpr bool operator==(const basic_transform &other) const;
+
+    constexpr bool operator!=(const basic_transform &other) const;
+
+    [[nodiscard]] constexpr const basic_vector<T> &offset() const;
+
+    // Whether the map is a translation only.
+    [[nodiscard]] constexpr bool is_translation() const;
+
+    // Vectors are only affected by the linear part.
+    constexpr basic_vector<T> operator()(const basic_vector<T> &vec) const;
+
+    constexpr basic_position<T> operator()(const basic_position<T> &point) const;
+
+    // The image of the cells covered by rect.
+    constexpr basic_rectangle<T> operator()(const basic_rectangle<T> &rect) const;
+
+    template<typename Allocator>
+    basic_rectangles<T, Allocator> operator()(const basic_rectangles<T, Allocator> &rects) const;
+
+private:
+    constexpr basic_transform(T xx, T xy, T yx, T yy, const basic_vector<T> &offset);
+
+    // Smallest of a * v and a * (v + len) for len > 0.
+    static constexpr T low(T a, T v, T len);
+
+    static constexpr T abs(T a);
+
+    T _xx, _xy, _yx, _yy;
+    basic_vector<T> _offset;
+};
+
+
+using Transform = basic_transform<int_fast32_t>;
+
+
+// Applies transform to every rectangle in place, in a single pass.
+// Translations and the diagonal reflection use the bulk kernels.
+template<typename T, typename Allocator>
+void transform_all(basic_rectangles<T, Allocator> &rects, const basic_transform<T> &transform);
+
+
+template<typename T>
+constexpr basic_transform<T>::basic_transform(T xx, T xy, T yx, T yy, const basic_vector<T> &offset)
+        : _xx(xx), _xy(xy), _yx(yx), _yy(yy), _offset(offset) {}
+
+template<typename T>
+constexpr basic_transform<T>::basic_transform() : basic_transform(1, 0, 0, 1, basic_vector<T>(0, 0)) {}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::translation(const basic_vector<T> &vec) {
+    return basic_transform(1, 0, 0, 1, vec);
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::scaling(T sx, T sy) {
+    assert(sx != 0 && sy != 0);
+    return basic_transform(sx, 0, 0, sy, basic_vector<T>(0, 0));
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::reflection_x() {
+    return basic_transform(1, 0, 0, -1, basic_vector<T>(0, 0));
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::reflection_y() {
+    return basic_transform(-1, 0, 0, 1, basic_vector<T>(0, 0));
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::reflection() {
+    return basic_transform(0, 1, 1, 0, basic_vector<T>(0, 0));
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::rotation(int quarter_turns) {
+    switch ((quarter_turns % 4 + 4) % 4) {
+        case 1:
+            return basic_transform(0, -1, 1, 0, basic_vector<T>(0, 0));
+        case 2:
+            return basic_transform(-1, 0, 0, -1, basic_vector<T>(0, 0));
+        case 3:
+            return basic_transform(0, 1, -1, 0, basic_vector<T>(0, 0));
+        default:
+            return basic_transform();
+    }
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::operator*(const basic_transform &other) const {
+    return basic_transform(this->_xx * other._xx + this->_xy * other._yx,
+                           this->_xx * other._xy + this->_xy * other._yy,
+                           this->_yx * other._xx + this->_yy * other._yx,
+                           this->_yx * other._xy + this->_yy * other._yy,
+                           (*this)(other._offset) + this->_offset);
+}
+
+template<typename T>
+constexpr basic_transform<T> basic_transform<T>::then(const basic_transform &next) const {
+    return next * *this;
+}
+
+template<typename T>
+constexpr bool basic_transform<T>::operator==(const basic_transform &other) const {
+    return this->_xx == other._xx && this->_xy == other._xy && this->_yx == other._yx && this->_yy == other._yy
+           && this->_offset == other._offset;
+}
+
+template<typename T>
+constexpr bool basic_transform<T>::operator!=(const basic_transform &other) const {
+    return !(*this == other);
+}
+
+template<typename T>
+constexpr const basic_vector<T> &basic_transform<T>::offset() const {
+    return this->_offset;
+}
+
+template<typename T>
+constexpr bool basic_transform<T>::is_translation() const {
+    return this->_xx == 1 && this->_xy == 0 && this->_yx == 0 && this->_yy == 1;
+}
+
+template<typename T>
+constexpr basic_vector<T> basic_transform<T>::operator()(const basic_vector<T> &vec) const {
+    return basic_vector<T>(this->_xx * vec.x() + this->_xy * vec.y(), this->_yx * vec.x() + this->_yy * vec.y());
+}
+
+template<typename T>
+constexpr basic_position<T> basic_transform<T>::operator()(const basic_position<T> &point) const {
+    return basic_position<T>(this->_xx * point.x() + this->_xy * point.y() + this->_offset.x(),
+                             this->_yx * point.x() + this->_yy * point.y() + this->_offset.y());
+}
+
+template<typename T>
+constexpr T basic_transform<T>::low(T a, T v, T len) {
+    return a < 0 ? a * (v + len) : a * v;
+}
+
+template<typename T>
+constexpr T basic_transform<T>::abs(T a) {
+    return a < 0 ? -a : a;
+}
+
+template<typename T>
+constexpr basic_rectangle<T> basic_transform<T>::operator()(const basic_rectangle<T> &rect) const {
+    // One of the two entries in every row of M is zero, so the image of
+    // the cells is spanned by the transformed corners.
+    const T x = rect.pos().x(), y = rect.pos().y(), w = rect.width(), h = rect.height();
+    return basic_rectangle<T>(abs(this->_xx) * w + abs(this->_xy) * h,
+                              abs(this->_yx) * w + abs(this->_yy) * h,
+                              basic_position<T>(low(this->_xx, x, w) + low(this->_xy, y, h) + this->_offset.x(),
+                                                low(this->_yx, x, w) + low(this->_yy, y, h) + this->_offset.y()));
+}
+
+template<typename T>
+template<typename Allocator>
+basic_rectangles<T, Allocator> basic_transform<T>::operator()(const basic_rectangles<T, Allocator> &rects) const {
+    basic_rectangles<T, Allocator> res(rects, rects.get_allocator());
+    transform_all(res, *this);
+    return res;
+}
+
+template<typename T, typename Allocator>
+void transform_all(basic_rectangles<T, Allocator> &rects, const basic_transform<T> &transform) {
+    if (transform.is_translation()) {
+        rects += transform.offset();
+    } else if (transform == basic_transform<T>::reflection()) {
+        rects.reflect();
+    } else {
+        for (basic_rectangle<T> &rect:rects)
+            rect = transform(rect);
+    }
+}
+
+#endif //JNP1_3_TRANSFORM_H